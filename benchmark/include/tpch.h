@@ -7,12 +7,12 @@ using namespace reffine::reffiner;
 
 struct TPCHQuery3 {
     using QueryFnTy = void (*)(ArrowTable**, ArrowTable*, ArrowTable*,
-                               ArrowTable*);
+                               ArrowTable*, int8_t, int64_t);
 
     shared_ptr<ArrowTable2> lineitem;
     shared_ptr<ArrowTable2> orders;
     shared_ptr<ArrowTable2> customer;
-    QueryFnTy query_fn;
+    shared_ptr<PreparedQuery<QueryFnTy>> query;
 
     TPCHQuery3()
     {
@@ -25,14 +25,16 @@ struct TPCHQuery3 {
         this->lineitem->build_index();
         this->orders->build_index();
         this->customer->build_index();
-        this->query_fn = compile_op<QueryFnTy>(this->build_op(1, 795484800));
+        this->query = make_shared<PreparedQuery<QueryFnTy>>(this->build_op());
     }
 
-    shared_ptr<Func> build_op(int8_t segment, int64_t date)
+    shared_ptr<Func> build_op()
     {
         auto lineitem = _sym("lineitem", this->lineitem->get_data_type());
         auto orders = _sym("orders", this->orders->get_data_type());
         auto customer = _sym("customer", this->customer->get_data_type());
+        auto segment = _sym("segment", _i8_t);
+        auto date = _sym("date", _i64_t);
         auto orderkey = _sym("orderkey", _i64_t);
 
         auto red = _red(
@@ -44,15 +46,15 @@ struct TPCHQuery3 {
 
                 auto new_s =
                     _add(s, _mul(l_extendedprice, _sub(_f64(1), l_discount)));
-                return _sel(_gt(l_shipdate, _i64(date)), new_s, s);
+                return _sel(_gt(l_shipdate, date), new_s, s);
             });
         auto red_sym = _sym("red", red);
 
         auto c_idx = _locate(customer, _get(orders[orderkey], 0));
         auto c_idx_sym = _sym("c_idx", c_idx);
         auto filter = _gte(c_idx_sym, _idx(0)) &
-                      _lt(_get(orders[orderkey], 3), _i64(date)) &
-                      _eq(_readdata(customer, c_idx_sym, 6), _i8(segment)) &
+                      _lt(_get(orders[orderkey], 3), date) &
+                      _eq(_readdata(customer, c_idx_sym, 6), segment) &
                       _gt(red_sym, _f64(0));
         auto filter_sym = _sym("filter", filter);
         auto pred =
@@ -62,7 +64,7 @@ struct TPCHQuery3 {
         auto op_sym = _sym("op", op);
 
         auto fn = _func("tpchquery3", op_sym,
-                        vector<Sym>{lineitem, orders, customer});
+                        vector<Sym>{lineitem, orders, customer, segment, date});
         fn->tbl[c_idx_sym] = c_idx;
         fn->tbl[filter_sym] = filter;
         fn->tbl[op_sym] = op;
@@ -71,11 +73,11 @@ struct TPCHQuery3 {
         return fn;
     }
 
-    ArrowTable* run()
+    ArrowTable* run(int8_t segment = 1, int64_t date = 795484800)
     {
         ArrowTable* out;
-        this->query_fn(&out, this->lineitem.get(), this->orders.get(),
-                       this->customer.get());
+        this->query->get()(&out, this->lineitem.get(), this->orders.get(),
+                           this->customer.get(), segment, date);
         return out;
     }
 };
@@ -158,32 +160,32 @@ struct TPCHQuery4 {
 };
 
 struct TPCHQuery6 {
-    using QueryFnTy = void (*)(double*, ArrowTable*);
+    using QueryFnTy = void (*)(double*, ArrowTable*, int64_t, int64_t, double,
+                               double);
 
     shared_ptr<ArrowTable2> lineitem;
-    QueryFnTy query_fn;
+    shared_ptr<PreparedQuery<QueryFnTy>> query;
 
     TPCHQuery6()
     {
         this->lineitem =
             load_arrow_file("../benchmark/arrow_data/lineitem.arrow", 2);
-        this->query_fn = compile_op<QueryFnTy>(
-            this->build_op(820454400, 852076800, 0.05f, 24.5f), true);
+        this->query =
+            make_shared<PreparedQuery<QueryFnTy>>(this->build_op(), true);
     }
 
-    shared_ptr<Func> build_op(int64_t start, int64_t end, double disc,
-                              double quant)
+    shared_ptr<Func> build_op()
     {
         auto vec_in_sym = _sym("lineitem", this->lineitem->get_data_type());
+        auto start_date = _sym("start_date", _i64_t);
+        auto end_date = _sym("end_date", _i64_t);
+        auto discount = _sym("discount", _f64_t);
+        auto quantity = _sym("quantity", _f64_t);
+
         auto red = _red(
             _subvec(vec_in_sym, _idx(0), _len(vec_in_sym, 1)),
             []() { return _f64(0); },
-            [start, end, disc, quant](Expr s, Expr v) {
-                auto start_date = _i64(start);
-                auto end_date = _i64(end);
-                auto discount = _f64(disc);
-                auto quantity = _f64(quant);
-
+            [start_date, end_date, discount, quantity](Expr s, Expr v) {
                 auto l_quantity = _get(v, 3);
                 auto l_extendedprice = _get(v, 4);
                 auto l_discount = _get(v, 5);
@@ -201,16 +203,20 @@ struct TPCHQuery6 {
             });
         auto red_sym = _sym("red", red);
 
-        auto fn = _func("tpchquery6", red_sym, vector<Sym>{vec_in_sym});
+        auto fn = _func("tpchquery6", red_sym,
+                        vector<Sym>{vec_in_sym, start_date, end_date, discount,
+                                    quantity});
         fn->tbl[red_sym] = red;
 
         return fn;
     }
 
-    double run()
+    double run(int64_t start = 820454400, int64_t end = 852076800,
+               double disc = 0.05f, double quant = 24.5f)
     {
         double out;
-        this->query_fn(&out, this->lineitem.get());
+        this->query->get()(&out, this->lineitem.get(), start, end, disc,
+                           quant);
         return out;
     }
 };
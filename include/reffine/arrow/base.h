@@ -1,10 +1,12 @@
 #ifndef INCLUDE_REFFINE_ARROW_BASE_H_
 #define INCLUDE_REFFINE_ARROW_BASE_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "reffine/arrow/abi.h"
+#include "reffine/arrow/pool.h"
 
 namespace reffine {
 
@@ -75,12 +77,16 @@ struct ArrowArray2 : public ArrowArray {
         {
             for (auto* child : this->children) { delete child; }
 
-            for (auto* buffer : this->buffers) { delete[] buffer; }
+            // Shared buffers are freed by their owners
+            for (size_t i = 0; i < this->buffers.size(); i++) {
+                if (!this->owners[i]) { bufpool.free(this->buffers[i]); }
+            }
         }
 
         size_t len;
         vector<ArrowArray2*> children;
         vector<const char*> buffers;
+        vector<shared_ptr<void>> owners;
     };
 
     ArrowArray2() {}
@@ -123,19 +129,38 @@ struct ArrowArray2 : public ArrowArray {
     template <typename T>
     T* add_buffer(size_t len)
     {
-        void* buf = new char[len * sizeof(T)];
+        void* buf = bufpool.alloc(len * sizeof(T));
         return (T*)this->add_buffer(buf);
     }
 
     void* add_buffer(void* buf)
     {
         this->pdata()->buffers.push_back((char*)buf);
+        this->pdata()->owners.push_back(nullptr);
         this->buffers = (const void**)this->pdata()->buffers.data();
         this->n_buffers = this->pdata()->buffers.size();
 
         return buf;
     }
 
+    // Points buffer `idx` into memory that `owner` keeps alive, for as long
+    // as this array lives, in place of a buffer of its own
+    void share_buffer(int idx, const void* buf, shared_ptr<void> owner)
+    {
+        auto* pdata = this->pdata();
+        if (!pdata->owners[idx]) { bufpool.free(pdata->buffers[idx]); }
+        pdata->buffers[idx] = (const char*)buf;
+        pdata->owners[idx] = owner;
+    }
+
+    // Records that the first `bytes` of buffer `idx` hold data, unless the
+    // buffer is shared
+    void commit_buffer(int idx, size_t bytes)
+    {
+        auto* pdata = this->pdata();
+        if (!pdata->owners[idx]) { bufpool.commit(pdata->buffers[idx], bytes); }
+    }
+
     ArrowArray2* get_child(int idx) { return this->pdata()->children[idx]; }
 
     template <typename T>
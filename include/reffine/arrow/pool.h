@@ -0,0 +1,60 @@
+#ifndef INCLUDE_REFFINE_ARROW_POOL_H_
+#define INCLUDE_REFFINE_ARROW_POOL_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace reffine {
+
+// Allocates the buffers of the vectors Reffine builds. Buffers come from the
+// heap until those in use reach the budget. Past it, a buffer is mapped from
+// an unlinked temporary file in the spill directory, so that under memory
+// pressure the kernel writes its pages back to disk and pages them in again
+// when they are read, rather than the process running out of memory.
+//
+// Vectors are allocated with a capacity far beyond the rows they end up
+// holding, and pages that are never written are never backed. A buffer thus
+// counts toward the budget for the bytes committed to it, as its vector is
+// written and once it is finalized. A heap buffer whose commit takes the heap
+// past the budget is moved to a spill file in place, at the same address, so
+// that code writing it can go on.
+class BufferPool {
+public:
+    void* alloc(size_t);
+    void free(const void*);
+
+    // Only the thread that writes the buffer may commit it
+    void commit(const void*, size_t);
+
+    // An empty spill directory stands for $TMPDIR, or /tmp
+    void set_budget(size_t, std::string = "");
+
+    size_t heap_bytes();
+    size_t spilled_bytes();
+
+private:
+    struct Buffer {
+        size_t size;
+        size_t used;
+        bool spilled;
+    };
+
+    int spill_file(size_t);
+    void* spill(size_t);
+    void spill_in_place(const void*, Buffer&);
+
+    size_t _budget = SIZE_MAX;
+    std::string _spill_dir;
+    size_t _heap_bytes = 0;
+    size_t _spilled_bytes = 0;
+    std::unordered_map<const void*, Buffer> _buffers;
+    std::mutex _mutex;
+};
+
+inline BufferPool bufpool;
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_ARROW_POOL_H_
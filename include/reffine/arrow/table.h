@@ -1,6 +1,7 @@
 #ifndef INCLUDE_REFFINE_ARROW_DEFS_H_
 #define INCLUDE_REFFINE_ARROW_DEFS_H_
 
+#include <cstring>
 #include <unordered_map>
 
 #include "reffine/arrow/base.h"
@@ -137,7 +138,50 @@ struct ArrowTable2 : public ArrowTable {
         init();
     }
 
+    // Makes column `col` read the data of column `src_col` of `src` rather
+    // than a copy of it, when both hold the same rows. The arrays of `src`
+    // are kept alive for as long as this table. If rows of `src` were
+    // skipped, being null in its iterator column, the rest are copied.
+    void share_column(size_t col, ArrowTable2& src, size_t src_col)
+    {
+        auto* child = this->_array->get_child(col);
+        auto* src_buf = (char*)get_vector_data_buf(&src, src_col);
+        if (this->array->length == src.array->length) {
+            child->share_buffer(1, src_buf, src._array);
+            return;
+        }
+
+        auto width = this->col_width(col);
+        auto* buf = child->get_buffer<char>(1);
+        int64_t len = 0;
+        for (int64_t i = 0; i < src.array->length; i++) {
+            if (get_vector_null_bit(&src, i, 0)) {
+                memcpy(buf + width * len++, src_buf + width * i, width);
+            }
+        }
+    }
+
+    // Charges the buffer pool for the first `len` rows, those written so far,
+    // rather than for the capacity the table was made with
+    void commit(size_t len)
+    {
+        for (int64_t col = 0; col < this->array->n_children; col++) {
+            auto* child = this->_array->get_child(col);
+            child->commit_buffer(0, child->buffers[0] ? len / 8 + 1 : 0);
+            child->commit_buffer(1, len * this->col_width(col));
+        }
+    }
+
 private:
+    size_t col_width(size_t col)
+    {
+        auto fmt = std::string(this->_schema->children[col]->format);
+        return (fmt == "c")                ? 1
+               : (fmt == "s")              ? 2
+               : (fmt == "i" || fmt == "f") ? 4
+                                            : 8;
+    }
+
     void init()
     {
         this->schema = this->_schema.get();
@@ -44,38 +44,63 @@ enum EncodeType {
 
 struct DataType {
     const BaseType btype;
-    const vector<DataType> dtypes;
+
+private:
+    // Element types and encodings are interned: structurally identical
+    // types share one immutable copy, so copying a DataType (which every IR
+    // node does) never copies the vectors
+    shared_ptr<const vector<DataType>> _dtypes;
+    shared_ptr<const vector<EncodeType>> _encodings;
+
+public:
+    const vector<DataType>& dtypes;
     const size_t dim;
-    const vector<EncodeType> encodings;
+    const vector<EncodeType>& encodings;
 
     explicit DataType(BaseType btype, vector<DataType> dtypes = {},
                       size_t dim = 0, vector<EncodeType> encodings = {})
-        : btype(btype), dtypes(dtypes), dim(dim), encodings(encodings)
+        : btype(btype),
+          _dtypes(intern(std::move(dtypes))),
+          _encodings(intern(std::move(encodings))),
+          dtypes(*_dtypes),
+          dim(dim),
+          encodings(*_encodings)
     {
         switch (btype) {
             case BaseType::STRUCT:
                 ASSERT(dim == 0);
-                ASSERT(dtypes.size() > 0);
+                ASSERT(this->dtypes.size() > 0);
                 break;
             case BaseType::PTR:
                 ASSERT(dim == 0);
-                ASSERT(dtypes.size() == 1);
+                ASSERT(this->dtypes.size() == 1);
                 break;
             case BaseType::VECTOR:
                 ASSERT(dim > 0);
-                ASSERT(dtypes.size() >= dim);
-                ASSERT(dtypes.size() == encodings.size());
+                ASSERT(this->dtypes.size() >= dim);
+                ASSERT(this->dtypes.size() == this->encodings.size());
                 break;
             default:
-                ASSERT(dtypes.size() == 0);
+                ASSERT(this->dtypes.size() == 0);
                 ASSERT(dim == 0);
                 break;
         }
     }
 
+    DataType(const DataType& o)
+        : btype(o.btype),
+          _dtypes(o._dtypes),
+          _encodings(o._encodings),
+          dtypes(*_dtypes),
+          dim(o.dim),
+          encodings(*_encodings)
+    {
+    }
+
     bool operator==(const DataType& o) const
     {
-        return (this->btype == o.btype) && (this->dtypes == o.dtypes) &&
+        return (this->btype == o.btype) &&
+               (this->_dtypes == o._dtypes || this->dtypes == o.dtypes) &&
                (this->dim == o.dim);
     }
 
@@ -247,6 +272,10 @@ struct DataType {
                 throw std::runtime_error("Invalid type " + this->str());
         }
     }
+
+private:
+    static shared_ptr<const vector<DataType>> intern(vector<DataType>);
+    static shared_ptr<const vector<EncodeType>> intern(vector<EncodeType>);
 };
 
 enum class MathOp {
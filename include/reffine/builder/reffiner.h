@@ -135,6 +135,8 @@ REGISTER_EXPR(_isval, IsValid)
 REGISTER_EXPR(_setval, SetValid)
 REGISTER_EXPR(_make, MakeVector)
 REGISTER_EXPR(_finalize, FinalizeVector)
+REGISTER_EXPR(_sharecol, ShareColumn)
+REGISTER_EXPR(_commit, CommitVector)
 REGISTER_EXPR(_buildidx, BuildIndex)
 REGISTER_EXPR(_vecarr, GetVectorArray)
 REGISTER_EXPR(_arrchild, GetArrayChild)
@@ -0,0 +1,58 @@
+#ifndef INCLUDE_REFFINE_ENGINE_COMPILER_H_
+#define INCLUDE_REFFINE_ENGINE_COMPILER_H_
+
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "llvm/Support/ThreadPool.h"
+#include "reffine/engine/engine.h"
+#include "reffine/ir/stmt.h"
+
+namespace reffine {
+
+// Lowers an Op-level Func to a Loop-level Func
+shared_ptr<Func> gen_loop(shared_ptr<Func>, bool vectorize = false);
+
+// Lowers a Loop-level Func to an LLVM module in the given context
+unique_ptr<llvm::Module> gen_module(shared_ptr<Func>, llvm::LLVMContext&,
+                                    bool use_cemitter = true);
+
+// Same as above, but in a fresh context owned by the returned module
+ThreadSafeModule gen_module(shared_ptr<Func>, bool use_cemitter = true);
+
+// Lowers a Loop-level Func to an LLVM module with one variant per ISA level.
+// Use ExecEngine::LookupVariant to pick the variant for the host.
+unique_ptr<llvm::Module> gen_multiversion_module(shared_ptr<Func>,
+                                                 llvm::LLVMContext&);
+
+// Compiles Funcs on a pool of worker threads. Each task runs the Reffine
+// passes and LLVM codegen in its own LLVMContext; the resulting modules are
+// optimized and lowered to machine code by ORC's concurrent dispatcher.
+class CompileService {
+public:
+    explicit CompileService(unsigned nthreads = 0)
+        : pool(llvm::hardware_concurrency(nthreads))
+    {
+    }
+
+    static CompileService* Get();
+
+    shared_future<ExecutorAddr> AddLoop(shared_ptr<Func>,
+                                        bool use_cemitter = true);
+    shared_future<ExecutorAddr> AddOp(shared_ptr<Func>, bool vectorize = false);
+    vector<shared_future<ExecutorAddr>> AddOps(vector<shared_ptr<Func>>,
+                                               bool vectorize = false);
+    shared_future<shared_ptr<JITQuery>> AddQuery(shared_ptr<Func>,
+                                                 bool vectorize = false);
+    void Wait();
+
+private:
+    ExecutorAddr compile(shared_ptr<Func>, bool);
+
+    llvm::DefaultThreadPool pool;
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_ENGINE_COMPILER_H_
@@ -1,6 +1,7 @@
 #ifndef INCLUDE_REFFINE_ENGINE_ENGINE_H_
 #define INCLUDE_REFFINE_ENGINE_ENGINE_H_
 
+#include <atomic>
 #include <memory>
 #include <utility>
 
@@ -15,6 +16,7 @@
 #include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/Orc/SelfExecutorProcessControl.h"
+#include "llvm/ExecutionEngine/Orc/TaskDispatch.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/LLVMContext.h"
@@ -22,6 +24,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/TargetSelect.h"
+#include "reffine/engine/isa.h"
 
 using namespace std;
 using namespace llvm;
@@ -29,13 +32,73 @@ using namespace llvm::orc;
 
 namespace reffine {
 
+// SectionMemoryManager that accounts its sections in a shared counter. The
+// linker keeps one per loaded object and destroys it with the object.
+class TrackedMemoryManager : public SectionMemoryManager {
+public:
+    explicit TrackedMemoryManager(atomic<size_t>& usage) : _usage(usage) {}
+    ~TrackedMemoryManager() override { _usage -= _allocated; }
+
+    uint8_t* allocateCodeSection(uintptr_t size, unsigned align, unsigned id,
+                                 StringRef name) override
+    {
+        track(size);
+        return SectionMemoryManager::allocateCodeSection(size, align, id,
+                                                         name);
+    }
+
+    uint8_t* allocateDataSection(uintptr_t size, unsigned align, unsigned id,
+                                 StringRef name, bool read_only) override
+    {
+        track(size);
+        return SectionMemoryManager::allocateDataSection(size, align, id, name,
+                                                         read_only);
+    }
+
+private:
+    void track(size_t size)
+    {
+        _allocated += size;
+        _usage += size;
+    }
+
+    atomic<size_t>& _usage;
+    size_t _allocated = 0;
+};
+
+// Handle to the code of a single compiled query. The query lives in its own
+// JITDylib, which is removed (freeing its code and data sections) when the
+// last handle is dropped.
+class JITQuery {
+public:
+    JITQuery(ExecutionSession& es, JITDylib& jd, ExecutorAddr addr)
+        : _es(es), _jd(jd), _addr(addr)
+    {
+    }
+    ~JITQuery();
+
+    template <typename FnTy>
+    FnTy get() const
+    {
+        return _addr.toPtr<FnTy>();
+    }
+
+private:
+    ExecutionSession& _es;
+    JITDylib& _jd;
+    ExecutorAddr _addr;
+};
+
 class ExecEngine {
 public:
     ExecEngine(JITTargetMachineBuilder jtmb, DataLayout dl)
-        : es(createExecutionSession()),
+        : mem_usage(0),
+          num_queries(0),
+          es(createExecutionSession()),
           linker(*es,
-                 [](const llvm::MemoryBuffer& MB) {
-                     return std::make_unique<llvm::SectionMemoryManager>();
+                 [this](const llvm::MemoryBuffer& MB) {
+                     return std::make_unique<TrackedMemoryManager>(
+                         this->mem_usage);
                  }),
           compiler(*es, linker,
                    make_unique<ConcurrentIRCompiler>(std::move(jtmb))),
@@ -53,22 +116,41 @@ public:
         add_opt_passes();
     }
 
+    ~ExecEngine();
+
     static ExecEngine* Get();
     void Optimize(Module&);
     void AddModule(unique_ptr<Module>);
+    void AddModule(ThreadSafeModule);
+    shared_ptr<JITQuery> AddQuery(ThreadSafeModule, StringRef);
     LLVMContext& GetCtx();
+    ExecutorAddr LookupAddr(StringRef);
+    ExecutorAddr LookupVariantAddr(StringRef);
+    size_t MemoryUsage() const { return mem_usage; }
 
     template <typename FnTy>
     FnTy Lookup(StringRef name)
     {
-        auto fn_sym = cantFail(es->lookup({&jd}, mangler(name.str())));
-        return fn_sym.getAddress().toPtr<FnTy>();
+        return LookupAddr(name).toPtr<FnTy>();
+    }
+
+    // Looks up the best variant of a multiversioned function that the host
+    // CPU can run
+    template <typename FnTy>
+    FnTy LookupVariant(StringRef name)
+    {
+        return LookupVariantAddr(name).toPtr<FnTy>();
     }
 
 private:
     static Expected<ThreadSafeModule> optimize_module(
         ThreadSafeModule, const MaterializationResponsibility&);
     static unique_ptr<ExecutionSession> createExecutionSession();
+    void add_module(ThreadSafeModule, JITDylib&);
+
+    // Declared first so that it outlives the memory managers of the linker
+    atomic<size_t> mem_usage;
+    atomic<size_t> num_queries;
 
     unique_ptr<ExecutionSession> es;
     RTDyldObjectLinkingLayer linker;
@@ -0,0 +1,43 @@
+#ifndef INCLUDE_REFFINE_ENGINE_ISA_H_
+#define INCLUDE_REFFINE_ENGINE_ISA_H_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace reffine {
+
+// x86-64 ISA levels that kernels are specialized for. GENERIC is used on
+// hosts where none of the levels apply and leaves code generation to the
+// compiler defaults.
+enum class ISA {
+    GENERIC,
+    SSE42,
+    AVX2,
+    AVX512,
+};
+
+// Best ISA level supported by the host CPU (queried through CPUID)
+ISA host_isa();
+
+// Variants emitted for multiversioned kernels, best first
+vector<ISA> isa_variants();
+
+// Variants that can run on the given ISA level, best first
+vector<ISA> isa_fallbacks(ISA);
+
+string isa_name(ISA);
+
+// Compiler flags used to generate code for an ISA level
+vector<string> isa_flags(ISA);
+
+// Vectorization factor for 64-bit lanes
+unsigned isa_vector_width(ISA);
+
+// Symbol name of the variant of `fn` compiled for the given ISA level
+string isa_symbol(const string& fn, ISA);
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_ENGINE_ISA_H_
@@ -2,6 +2,8 @@
 #define INCLUDE_REFFINE_ENGINE_MEMORY_H_
 
 #include <functional>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include "reffine/arrow/table.h"
@@ -15,9 +17,14 @@ public:
     uint32_t add_builder(VectorBuilderFnTy);
     ArrowTable* get_table(uint32_t, int64_t);
 
+    // Vectors written past the budget, in bytes, are spilled to files in the
+    // spill directory (see BufferPool)
+    void set_budget(size_t, std::string = "");
+
 private:
     std::vector<VectorBuilderFnTy> _builders;
     std::vector<shared_ptr<ArrowTable2>> _tables;
+    std::mutex _mutex;
 };
 
 inline MemoryManager memman;
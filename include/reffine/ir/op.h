@@ -93,14 +93,18 @@ struct In : public ExprNode {
 
 typedef function<Expr()> InitFnTy;           // () -> state
 typedef function<Expr(Expr, Expr)> AccFnTy;  // (state, val) -> state
+typedef function<Expr(Expr)> DoneFnTy;       // state -> is final
 
 struct Reduce : public ExprNode {
     Expr vec;
     InitFnTy init;
     AccFnTy acc;
+    // Optional. Once it holds, no further row changes the state and the
+    // reduction stops. Detected for saturating accumulators if not given.
+    DoneFnTy done;
 
-    Reduce(Expr vec, InitFnTy init, AccFnTy acc)
-        : ExprNode(init()->type), vec(vec), init(init), acc(acc)
+    Reduce(Expr vec, InitFnTy init, AccFnTy acc, DoneFnTy done = nullptr)
+        : ExprNode(init()->type), vec(vec), init(init), acc(acc), done(done)
     {
         ASSERT(vec->type.is_vector());
         auto tmp_state = init();
@@ -108,9 +112,17 @@ struct Reduce : public ExprNode {
         auto tmp_state2 = acc(tmp_state, tmp_val);
 
         ASSERT(tmp_state2->type == tmp_state->type);
+
+        if (!this->done) { this->done = saturation(); }
+        if (this->done) {
+            ASSERT(this->done(tmp_state)->type == types::BOOL);
+        }
     }
 
     void Accept(Visitor&) final;
+
+private:
+    DoneFnTy saturation() const;
 };
 
 }  // namespace reffine
@@ -181,6 +181,26 @@ struct FinalizeVector : public Call {
     }
 };
 
+struct ShareColumn : public Call {
+    ShareColumn(Expr vec, size_t col, Expr src, size_t src_col)
+        : Call("share_vector_col", types::VOID,
+               vector<Expr>{vec, make_shared<Const>(types::UINT32, col), src,
+                            make_shared<Const>(types::UINT32, src_col)})
+    {
+        ASSERT(vec->type.is_vector());
+        ASSERT(src->type.is_vector());
+    }
+};
+
+struct CommitVector : public Call {
+    CommitVector(Expr vec, Expr len)
+        : Call("commit_vector", types::VOID, vector<Expr>{vec, len})
+    {
+        ASSERT(vec->type.is_vector());
+        ASSERT(len->type.is_idx());
+    }
+};
+
 struct BuildIndex : public Call {
     BuildIndex(Expr vec)
         : Call("build_vector_index", vec->type, vector<Expr>{vec})
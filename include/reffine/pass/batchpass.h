@@ -0,0 +1,44 @@
+#ifndef INCLUDE_REFFINE_PASS_BATCHPASS_H_
+#define INCLUDE_REFFINE_PASS_BATCHPASS_H_
+
+#include <map>
+#include <string>
+
+#include "reffine/ir/stmt.h"
+#include "reffine/pass/irclone.h"
+
+namespace reffine {
+
+// Batches queries over the same input vectors into one function that returns
+// the outputs of all queries as a struct. The reductions of the queries are
+// then fused by FusePass, so that queries scanning the same input vectors
+// read them once for the whole batch.
+//
+// The k-th vector input of every query is the k-th vector input of the batch.
+// The scalar inputs of each query follow them, query by query, so that every
+// query keeps its own parameters. An input symbol shared by several queries
+// is a single parameter of the batch.
+//
+// The symbols of a query are renamed in the batch, so the symbols that the
+// init, acc and done functions of its reductions capture are mapped to their
+// batched counterparts when those functions are called.
+class BatchPass : public IRClone {
+public:
+    static shared_ptr<Func> Build(const vector<shared_ptr<Func>>&,
+                                  string name);
+
+private:
+    using SymMap = map<Sym, Sym>;
+
+    BatchPass() {}
+
+    Expr visit(Sym) final;
+    Expr visit(Reduce&) final;
+
+    size_t _query = 0;
+    shared_ptr<SymMap> _captures;  // of the current query
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_BATCHPASS_H_
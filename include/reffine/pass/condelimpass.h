@@ -0,0 +1,62 @@
+#ifndef INCLUDE_REFFINE_PASS_CONDELIMPASS_H_
+#define INCLUDE_REFFINE_PASS_CONDELIMPASS_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "reffine/ir/loop.h"
+#include "reffine/ir/op.h"
+#include "reffine/pass/irclone.h"
+#include "z3++.h"
+
+namespace reffine {
+
+// Memory locations read or written by an expression
+struct MemAccess {
+    set<ExprNode*> allocs;  // symbols bound to an Alloc
+    bool heap = false;      // vectors, arrays and other non-Alloc memory
+    bool all = false;       // unknown side effects (opaque calls)
+};
+
+// Removes conditions that are implied by the enclosing loop and branch
+// guards, and branches whose condition can never hold. Reductions over ops
+// with a contradictory predicate are replaced by their initial value.
+class CondElimPass : public IRClone {
+public:
+    static shared_ptr<Func> Build(shared_ptr<Func>);
+
+private:
+    CondElimPass() : _z3ctx(make_shared<z3::context>())
+    {
+        this->_reuse_syms = true;
+    }
+
+    Expr visit(NaryExpr&) final;
+    Expr visit(Select&) final;
+    Expr visit(IfElse&) final;
+    Expr visit(Stmts&) final;
+    Expr visit(Loop&) final;
+    Expr visit(Reduce&) final;
+
+    bool prove(Expr);
+    bool refute(Expr);
+    Expr abstract(Expr);
+    const string& key(Expr);
+    const MemAccess& reads(Expr);
+    const MemAccess& writes(Expr);
+    void kill_facts(const MemAccess&);
+
+    shared_ptr<z3::context> _z3ctx;
+    vector<pair<Expr, bool>> _facts;  // conditions known to hold or not
+
+    map<ExprNode*, string> _keys;
+    map<string, Sym> _vars;  // solver variables for opaque expressions
+    map<ExprNode*, MemAccess> _reads;
+    map<ExprNode*, MemAccess> _writes;
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_CONDELIMPASS_H_
@@ -0,0 +1,68 @@
+#ifndef INCLUDE_REFFINE_PASS_CSEPASS_H_
+#define INCLUDE_REFFINE_PASS_CSEPASS_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "reffine/ir/loop.h"
+#include "reffine/ir/op.h"
+#include "reffine/pass/irclone.h"
+
+namespace reffine {
+
+// Common subexpression elimination. Repeated Element, ReadData, pure calls
+// (vector_locate and the buffer accessors) and pure arithmetic within the
+// same scope are computed once into a shared symbol.
+class CSEPass : public IRClone {
+public:
+    static shared_ptr<Func> Build(shared_ptr<Func>);
+
+private:
+    // A scope is a block in which a symbol definition is visible: an Op, a
+    // field of a Loop or a branch of an IfElse
+    using Scope = pair<ExprNode*, int>;
+    using ScopedKey = pair<Scope, string>;
+
+    struct ExprKey {
+        string key;  // empty if the expression is not eligible
+        bool hazard;  // unsafe to evaluate when it was not before
+    };
+
+    explicit CSEPass(bool counting) : _counting(counting)
+    {
+        this->_reuse_syms = true;
+    }
+
+    Expr visit(NaryExpr&) final;
+    Expr visit(Get&) final;
+    Expr visit(Cast&) final;
+    Expr visit(Element&) final;
+    Expr visit(Call&) final;
+    Expr visit(ReadData&) final;
+    Expr visit(Select&) final;
+    Expr visit(IfElse&) final;
+    Expr visit(Op&) final;
+    Expr visit(Loop&) final;
+
+    const ExprKey& key(Expr);
+    Expr share(ExprNode&, function<Expr()>);
+    Expr eval_in(Expr, Scope);
+    Expr eval_guarded(Expr);
+    void collect_safe_elems(Expr);
+
+    bool _counting;
+    vector<Scope> _scopes = {{nullptr, 0}};
+    int _guards = 0;
+
+    map<ExprNode*, ExprKey> _keys;
+    set<pair<ExprNode*, ExprNode*>> _safe_elems;  // (vec, iter) pairs
+    map<ScopedKey, int> _counts;
+    set<ScopedKey> _hazards;
+    map<ScopedKey, Sym> _shared;
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_CSEPASS_H_
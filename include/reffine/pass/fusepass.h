@@ -0,0 +1,61 @@
+#ifndef INCLUDE_REFFINE_PASS_FUSEPASS_H_
+#define INCLUDE_REFFINE_PASS_FUSEPASS_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "reffine/ir/op.h"
+#include "reffine/ir/stmt.h"
+#include "reffine/pass/irclone.h"
+
+namespace reffine {
+
+// Horizontal fusion of reductions. Reductions of a function that read the
+// same rows are merged into one reduction whose state is the struct of their
+// states, so that LoopGen builds a single loop for all of them:
+//  - Reductions over the same vector or structurally equal subvectors fold
+//    every row into every state.
+//  - Reductions over Ops that scan the same vectors with the same iterator
+//    types scan them once. Each Op contributes its predicate as an output, so
+//    that its accumulator only folds the rows it selects. As the outputs of
+//    every member are computed for the rows any member selects, an Op with
+//    conditions of its own is only fused if its outputs and conditions are
+//    safe to compute for any row it scans.
+// Reductions that depend on each other are never fused.
+class FusePass : public IRClone {
+public:
+    static shared_ptr<Func> Build(shared_ptr<Func>);
+
+private:
+    struct Member {
+        Sym sym;
+        shared_ptr<Reduce> red;
+        set<Sym> deps;
+        bool used = false;
+        Expr pred;
+        vector<Expr> outputs;
+    };
+
+    struct Group {
+        vector<Member> members;
+        vector<Sym> iters;  // empty unless the members reduce Ops
+        Expr vec;
+        Sym sym;
+    };
+
+    FusePass() { this->_reuse_syms = true; }
+
+    Expr visit(Reduce&) final;
+
+    void group(Func&);
+    shared_ptr<Reduce> fuse(Group&, SymTable&);
+
+    vector<Group> _groups;
+    map<ExprNode*, pair<size_t, size_t>> _members;  // (group, member)
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_FUSEPASS_H_
@@ -50,6 +50,11 @@ protected:
     Expr visit(SubVector&) override;
     Expr visit(Func&) override;
 
+    // Keep the symbols of the input function instead of creating new ones.
+    // Needed for clones that run before LoopGen: the init and acc functions
+    // of a Reduce are not cloned and still return the symbols they capture.
+    bool _reuse_syms = false;
+
 private:
     shared_ptr<Op> visit_op(Op&);
 };
@@ -0,0 +1,43 @@
+#ifndef INCLUDE_REFFINE_PASS_LICMPASS_H_
+#define INCLUDE_REFFINE_PASS_LICMPASS_H_
+
+#include <map>
+#include <set>
+
+#include "reffine/ir/loop.h"
+#include "reffine/pass/irclone.h"
+
+namespace reffine {
+
+// Loop-invariant code motion on the loop IR. Buffer pointer derivations and
+// arithmetic that only depend on the function inputs are moved into the init
+// of the outermost enclosing loop, so loop bodies only contain per-row work.
+class LICMPass : public IRClone {
+public:
+    static shared_ptr<Func> Build(shared_ptr<Func>);
+
+private:
+    Expr visit(Sym) final;
+    Expr visit(Cast&) final;
+    Expr visit(Get&) final;
+    Expr visit(NaryExpr&) final;
+    Expr visit(Call&) final;
+    Expr visit(FetchDataPtr&) final;
+    Expr visit(Loop&) final;
+    Expr visit(Func&) final;
+
+    bool is_invariant(Expr);
+    Expr hoist(ExprNode&, function<Expr()>);
+
+    set<ExprNode*> _inputs;
+    set<ExprNode*> _defs;  // values bound to symbols in the input tbl
+    map<ExprNode*, bool> _invariant;
+
+    int _loop_depth = 0;
+    bool _hoisting = false;
+    vector<Expr> _hoisted;
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_LICMPASS_H_
@@ -3,25 +3,30 @@
 
 #include <cstdlib>
 #include <fstream>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "reffine/engine/isa.h"
 #include "reffine/pass/base/irgen.h"
 
 using namespace std;
 
-extern unsigned char vinstr_ll[];
-extern unsigned int vinstr_ll_len;
+extern unsigned char vinstr_bc[];
+extern unsigned int vinstr_bc_len;
 
 namespace reffine {
 
@@ -34,14 +39,25 @@ public:
           _llmod(llmod),
           _builder(make_unique<llvm::IRBuilder<>>(llmod.getContext()))
     {
-        std::string vinstr(reinterpret_cast<char*>(vinstr_ll), vinstr_ll_len);
-        register_code(vinstr);
     }
 
-    void parse(const string&);
+    void parse(const string&, ISA isa = host_isa());
+    // Compiles one variant of `fn_name` per ISA level (see isa_symbol)
+    void parse_multiversion(const string&, const string& fn_name);
 
 private:
+    unique_ptr<llvm::Module> parse_ir(const string&);
     void register_code(const string&);
+    void link_vinstr();
+    void add_alias_scopes();
+    Expr resolve(Expr);
+    Expr made_vector(Expr);
+    string buffer_key(Expr);
+    string expr_key(Expr);
+    void annotate(llvm::Instruction*, Expr addr, const DataType&);
+    llvm::MDNode* loop_hints();
+    llvm::MDNode* tbaa_tag(const DataType&);
+    static string compile_code(const string&, ISA);
 
     llvm::Value* visit(Sym) final;
     llvm::Value* visit(Call&) final;
@@ -81,6 +97,15 @@ private:
     llvm::Module& _llmod;
     unique_ptr<llvm::IRBuilder<>> _builder;
 
+    // Loads and stores into Arrow buffers, keyed by the buffer they access
+    vector<pair<llvm::Instruction*, string>> _buffer_accesses;
+    // Buffers of vectors made in the function -> key of their vector
+    map<string, string> _made_buffers;
+    // Vectors some of whose columns are shared with another vector
+    set<string> _shared_vecs;
+    llvm::MDNode* _tbaa_root = nullptr;
+    map<string, llvm::MDNode*> _tbaa_tags;
+
     // Helpers
     llvm::LoadInst* CreateLoad(llvm::Type*, llvm::Value*);
     llvm::StoreInst* CreateStore(llvm::Value*, llvm::Value*);
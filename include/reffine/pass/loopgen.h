@@ -5,6 +5,8 @@
 
 namespace reffine {
 
+struct ReffineSolverPool;
+
 class LoopGen : public IRClone {
 public:
     LoopGen(unique_ptr<IRGenCtx> ctx = nullptr, bool vectorize = true)
@@ -20,6 +22,7 @@ private:
 
     map<Expr, map<Expr, Expr>> _vec_iter_idx_map;  // vec -> iter -> idx
     bool _vectorize;
+    shared_ptr<ReffineSolverPool> _solver_pool;
 };
 
 }  // namespace reffine
@@ -0,0 +1,44 @@
+#ifndef INCLUDE_REFFINE_PASS_PIPELINEPASS_H_
+#define INCLUDE_REFFINE_PASS_PIPELINEPASS_H_
+
+#include <map>
+#include <set>
+
+#include "reffine/ir/op.h"
+#include "reffine/ir/stmt.h"
+#include "reffine/pass/irclone.h"
+
+namespace reffine {
+
+// Pipelines producer Ops into their consumers, so that the vector an Op
+// produces is not materialized when it is only read in iterator order:
+//  - An Op that scans the producer with In(t, vec) and reads it only through
+//    vec[t] iterates over the producer's own iteration space instead, and
+//    reads its outputs directly.
+//  - A Reduce over the producer reduces the producer's Op.
+// Producers with any other use (lookups by other keys, InitVal
+// dependencies, function outputs) are pipeline breakers and are still
+// materialized.
+class PipelinePass : public IRClone {
+public:
+    static shared_ptr<Func> Build(shared_ptr<Func>);
+
+private:
+    explicit PipelinePass(set<Sym> producers) : _producers(producers)
+    {
+        this->_reuse_syms = true;
+    }
+
+    Expr visit(Op&) final;
+    Expr visit(Element&) final;
+    Expr visit(Reduce&) final;
+
+    Expr eval_pred(Expr, const vector<Sym>&);
+
+    set<Sym> _producers;
+    map<Sym, Expr> _scan_iters;  // iterator each pipelined producer is read at
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_PIPELINEPASS_H_
@@ -0,0 +1,47 @@
+#ifndef INCLUDE_REFFINE_PASS_PROJECTPASS_H_
+#define INCLUDE_REFFINE_PASS_PROJECTPASS_H_
+
+#include <map>
+#include <set>
+
+#include "reffine/ir/loop.h"
+#include "reffine/ir/op_to_loop.h"
+#include "reffine/pass/irclone.h"
+
+namespace reffine {
+
+using ColumnSet = set<size_t>;
+
+// Projection pushdown for loop functions generated by LoopGen:
+//  - Columns reports the columns each vector input is read at, iterator
+//    columns included, so that a loader only reads those columns.
+//  - Build rewrites the function for inputs that hold only the projected
+//    columns, in their original order. The types of the inputs drop the other
+//    columns and reads of the inputs are remapped to the new column indexes.
+class ProjectPass : public IRClone {
+public:
+    static map<Sym, ColumnSet> Columns(shared_ptr<Func>);
+    static shared_ptr<Func> Build(shared_ptr<Func>,
+                                  const map<Sym, ColumnSet>&);
+
+private:
+    explicit ProjectPass(const map<Sym, ColumnSet>& cols) : _cols(cols) {}
+
+    Expr visit(Sym) final;
+    Expr visit(ReadRunEnd&) final;
+    Expr visit(ReadData&) final;
+    Expr visit(ReadBit&) final;
+    Expr visit(Length&) final;
+    Expr visit(FetchDataPtr&) final;
+    Expr visit(Call&) final;
+    Expr visit(Func&) final;
+
+    size_t project(Expr, size_t);
+
+    const map<Sym, ColumnSet>& _cols;
+    map<Sym, vector<size_t>> _projections;  // new input -> its old columns
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_PROJECTPASS_H_
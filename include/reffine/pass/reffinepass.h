@@ -1,20 +1,55 @@
 #ifndef INCLUDE_REFFINE_PASS_REFFINEPASS_H_
 #define INCLUDE_REFFINE_PASS_REFFINEPASS_H_
 
+#include <cmath>
+#include <optional>
 #include <set>
+#include <string>
+#include <unordered_map>
 
 #include "reffine/iter/iter_space.h"
 #include "reffine/pass/base/irgen.h"
 #include "reffine/pass/irclone.h"
 #include "reffine/pass/loopgen.h"
+#include "reffine/pass/z3solver.h"
 
 namespace reffine {
 
 using ReffineCtx = ValGenCtx<ISpace>;
 
+// Bound of an iterator: `iter >= val` (lower) or `iter <= val` (upper)
+struct IterBound {
+    bool is_lower;
+    Expr val;
+};
+
+// Constant range of the iterator values a scan can visit. Sides that are not
+// bounded by constants are infinite.
+struct IterRange {
+    double lo = -INFINITY;
+    double hi = INFINITY;
+};
+
+// Solver state shared by all Reffine runs of a single compile: one Z3
+// context and the bounds it has derived, keyed by predicate
+struct ReffineSolverPool {
+    shared_ptr<z3::context> z3ctx;
+    unordered_map<string, optional<IterBound>> bounds;
+};
+
 class Reffine : public ValGen<ISpace> {
 public:
-    Reffine(unique_ptr<ReffineCtx> ctx) : ValGen<ISpace>(std::move(ctx)) {}
+    Reffine(unique_ptr<ReffineCtx> ctx,
+            shared_ptr<ReffineSolverPool> pool = nullptr)
+        : ValGen<ISpace>(std::move(ctx)),
+          _pool(pool ? pool : make_shared<ReffineSolverPool>())
+    {
+    }
+
+    // Rows of the input `vec` that `func` can read, from the bounds of the
+    // Ops scanning it. Unbounded unless every use of `vec` is a scan or an
+    // element read at the scanning iterator.
+    static IterRange ScanRange(shared_ptr<Func> func, Sym vec);
 
 private:
     ISpace visit(NaryExpr&) final;
@@ -24,12 +59,16 @@ private:
     ISpace visit(Op&) final;
 
     ISpace extract_bound(NaryExpr&);
+    optional<IterBound> affine_bound(NaryExpr&);
+    optional<IterBound> solve_bound(NaryExpr&);
+    bool is_affine(Expr);
 
     Sym& iter() { return this->_iter; }
     set<Sym>& vars() { return this->_vars; }
 
     Sym _iter;
     set<Sym> _vars;
+    shared_ptr<ReffineSolverPool> _pool;
 
     friend class LoopGen;
 };
@@ -0,0 +1,34 @@
+#ifndef INCLUDE_REFFINE_PASS_SPECIALIZEPASS_H_
+#define INCLUDE_REFFINE_PASS_SPECIALIZEPASS_H_
+
+#include <map>
+#include <string>
+
+#include "reffine/ir/stmt.h"
+#include "reffine/pass/irclone.h"
+
+namespace reffine {
+
+// Specializes a function for fixed values of some of its scalar inputs. The
+// inputs stay in the signature so that the specialized function can be
+// called in place of the generic one, but their uses are replaced by the
+// given constants.
+class SpecializePass : public IRClone {
+public:
+    static shared_ptr<Func> Build(shared_ptr<Func>, const map<Sym, Expr>&,
+                                  string name);
+
+private:
+    explicit SpecializePass(const map<Sym, Expr>& params) : _params(params)
+    {
+        this->_reuse_syms = true;
+    }
+
+    Expr visit(Func&) final;
+
+    const map<Sym, Expr>& _params;
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_SPECIALIZEPASS_H_
@@ -0,0 +1,48 @@
+#ifndef INCLUDE_REFFINE_PASS_STREAMPASS_H_
+#define INCLUDE_REFFINE_PASS_STREAMPASS_H_
+
+#include "reffine/ir/op.h"
+#include "reffine/ir/stmt.h"
+#include "reffine/pass/irclone.h"
+
+namespace reffine {
+
+// Turns a function that returns a reduction into one step of a streaming
+// reduction. The step takes two more inputs, the state reached so far and
+// whether this is the first batch, and folds one batch of its vector inputs
+// into that state instead of the initial one.
+class StreamPass : public IRClone {
+public:
+    static shared_ptr<Func> Build(shared_ptr<Func>);
+
+    // A function without inputs that returns the initial state, which is
+    // the result of a stream without batches
+    static shared_ptr<Func> Init(shared_ptr<Func>);
+
+    // A function from the state reached so far to whether the reduction is
+    // done, so that no more batches need to be read, or nullptr if the
+    // reduction never finishes early
+    static shared_ptr<Func> Done(shared_ptr<Func>);
+
+    // Whether a loop function generated from a step locates rows of its
+    // inputs by iterator, which needs the vector index of each batch
+    static bool Locates(shared_ptr<Func>);
+
+private:
+    StreamPass(ExprNode* red, Sym state, Sym first)
+        : _output_red(red), _state(state), _first(first)
+    {
+        this->_reuse_syms = true;
+    }
+
+    Expr visit(Reduce&) final;
+    Expr visit(Func&) final;
+
+    ExprNode* _output_red;  // reduction the function returns
+    Sym _state;
+    Sym _first;
+};
+
+}  // namespace reffine
+
+#endif  // INCLUDE_REFFINE_PASS_STREAMPASS_H_
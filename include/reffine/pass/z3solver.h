@@ -1,14 +1,30 @@
 #ifndef INCLUDE_REFFINE_PASS_Z3SOLVER_H_
 #define INCLUDE_REFFINE_PASS_Z3SOLVER_H_
 
+#include <map>
+#include <string>
+
 #include "reffine/pass/base/visitor.h"
 #include "z3++.h"
 
 namespace reffine {
 
+// Integer symbols are modelled as unbounded integers, so facts derived here
+// ignore overflow: they only hold for values within the range of the type.
 class Z3Solver : public Visitor {
 public:
+    Z3Solver() : Z3Solver(make_shared<z3::context>()) {}
+    // Solvers created from the same context share its declarations, so one
+    // context can be pooled across many short-lived solvers
+    explicit Z3Solver(shared_ptr<z3::context> ctx)
+        : _ctx(ctx), _val(_ctx->bool_val(true)), _s(*_ctx)
+    {
+    }
+
     bool check(Expr);
+    // Unlike !check(), only true if the conjunction is proven unsatisfiable
+    bool refute(Expr);
+    void set_timeout(unsigned);
     shared_ptr<Const> get(Expr);
 
 private:
@@ -19,12 +35,17 @@ private:
     z3::expr eval(Expr expr);
     z3::expr& val() { return _val; }
     z3::solver& s() { return _s; }
-    z3::context& ctx() { return _ctx; }
+    z3::context& ctx() { return *_ctx; }
     void assign(z3::expr e) { swap(e, val()); }
+    string sym_name(SymNode&);
+
+    shared_ptr<z3::context> _ctx;
+    z3::expr _val;
+    z3::solver _s;
 
-    z3::context _ctx;
-    z3::expr _val = _ctx.bool_val(true);
-    z3::solver _s = _ctx;
+    // Distinct symbols may share a name, such as the iterators of nested
+    // ops, so Z3 constants are named after the symbol they stand for
+    map<const SymNode*, string> _names;
 };
 
 }  // namespace reffine
@@ -1,58 +1,240 @@
 #ifndef INCLUDE_REFFINE_UTILS_H_
 #define INCLUDE_REFFINE_UTILS_H_
 
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "reffine/arrow/table.h"
 #include "reffine/base/log.h"
+#include "reffine/engine/compiler.h"
 #include "reffine/engine/engine.h"
+#include "reffine/pass/batchpass.h"
 #include "reffine/pass/canonpass.h"
 #include "reffine/pass/cemitter.h"
 #include "reffine/pass/llvmgen.h"
 #include "reffine/pass/loopgen.h"
 #include "reffine/pass/printer2.h"
+#include "reffine/pass/projectpass.h"
 #include "reffine/pass/readwritepass.h"
 #include "reffine/pass/reffinepass.h"
 #include "reffine/pass/scalarpass.h"
+#include "reffine/pass/specializepass.h"
+#include "reffine/pass/streampass.h"
 
 using namespace reffine;
 
 template <typename T>
 T compile_loop(shared_ptr<Func> loop, bool use_cemitter = true)
 {
-    LOG(INFO) << "Loop IR (raw):" << std::endl << loop->str() << std::endl;
-    auto loop1 = CanonPass().eval(loop);
-    LOG(INFO) << "Loop IR (canon):" << std::endl << loop1->str() << std::endl;
-    auto loop2 = ReadWritePass().eval(loop1);
-    LOG(INFO) << "Loop IR (readwrite):" << std::endl
-              << loop2->str() << std::endl;
-    auto loop3 = ScalarPass().eval(loop2);
-    LOG(INFO) << "Loop IR (scalar):" << std::endl << loop3->str() << std::endl;
-
     auto jit = ExecEngine::Get();
-    auto llmod = make_unique<llvm::Module>("__" + loop->name, jit->GetCtx());
-    if (use_cemitter) {
-        auto ccode = CEmitter::Build(loop3);
-        LOG(INFO) << "C Code:" << std::endl << ccode << std::endl;
-        LLVMGen(*llmod).parse(ccode);
-    } else {
-        LLVMGen(*llmod).eval(loop3);
-    }
-    LOG(INFO) << "LLVM IR:" << std::endl
-              << IRPrinter2::Build(*llmod) << std::endl;
-    jit->AddModule(std::move(llmod));
+    jit->AddModule(gen_module(loop, jit->GetCtx(), use_cemitter));
     return jit->Lookup<T>(loop->name);
 }
 
 template <typename T>
 T compile_op(std::shared_ptr<Func> op, bool vectorize = false)
 {
-    LOG(INFO) << "Reffine IR:" << std::endl << op->str() << std::endl;
-    auto loopgen = LoopGen(nullptr, vectorize);
-    loopgen.eval(op);
-    return compile_loop<T>(loopgen.ctx().out_func);
+    return compile_loop<T>(gen_loop(op, vectorize));
+}
+
+template <typename T>
+future<T> compile_op_async(std::shared_ptr<Func> op, bool vectorize = false)
+{
+    auto addr = CompileService::Get()->AddOp(op, vectorize);
+    return std::async(std::launch::deferred,
+                      [addr]() { return addr.get().toPtr<T>(); });
 }
 
+// Compiles `op` into its own JITDylib; the code is freed with the handle
+inline shared_ptr<JITQuery> compile_query(std::shared_ptr<Func> op,
+                                          bool vectorize = false)
+{
+    auto loop = gen_loop(op, vectorize);
+    return ExecEngine::Get()->AddQuery(gen_module(loop), loop->name);
+}
+
+// Compiles queries over the same input vectors into one kernel that reads the
+// vectors once and writes the outputs of all queries into a struct. The
+// kernel takes the vectors, then the scalar inputs of each query in turn.
+template <typename T>
+T compile_batch(const vector<shared_ptr<Func>>& ops, string name,
+                bool vectorize = false)
+{
+    return compile_op<T>(BatchPass::Build(ops, name), vectorize);
+}
+
+// A query compiled once with its scalar inputs as runtime parameters, so
+// that one kernel serves every parameter binding. Hot bindings can be
+// compiled into kernels specialized for those values, which keep the
+// generic signature.
+template <typename FnTy>
+class PreparedQuery {
+public:
+    explicit PreparedQuery(shared_ptr<Func> op, bool vectorize = false)
+        : _op(op), _vectorize(vectorize), _fn(compile_op<FnTy>(op, vectorize))
+    {
+    }
+
+    FnTy get() const { return _fn; }
+
+    FnTy specialize(const map<Sym, Expr>& params)
+    {
+        string key;
+        for (auto& [param, val] : params) {
+            key += param->name + "=" + val->str() + ";";
+        }
+
+        lock_guard<mutex> lock(_mtx);
+        if (!_specialized.contains(key)) {
+            auto name = _op->name + "_spec" + to_string(_specialized.size());
+            auto op = SpecializePass::Build(_op, params, name);
+            _specialized[key] = compile_op<FnTy>(op, _vectorize);
+        }
+        return _specialized.at(key);
+    }
+
+private:
+    shared_ptr<Func> _op;
+    bool _vectorize;
+    FnTy _fn;
+
+    mutex _mtx;
+    map<string, FnTy> _specialized;
+};
+
+// A reduction over one vector input, compiled to run over an unbounded
+// ArrowArrayStream batch by batch. The reduction state is carried from one
+// batch to the next, so only one batch is held in memory at a time. No more
+// batches are read once the reduction is done.
+template <typename StateTy>
+class StreamQuery {
+public:
+    explicit StreamQuery(shared_ptr<Func> op, bool vectorize = false)
+        : _dim(input_vec(op)->type.dim)
+    {
+        auto loop = gen_loop(StreamPass::Build(op), vectorize);
+        this->_locates = StreamPass::Locates(loop);
+        this->_fn = compile_loop<FnTy>(loop);
+        this->_init = compile_op<InitFnTy>(StreamPass::Init(op));
+        if (auto done = StreamPass::Done(op)) {
+            this->_done = compile_op<DoneFnTy>(done);
+        }
+    }
+
+    // A stream without batches yields the initial state
+    StateTy run(ArrowArrayStream* stream)
+    {
+        StateTy state;
+        this->_init(&state);
+        bool first = true;
+        while (!this->done(state)) {
+            auto tbl = make_shared<ArrowTable2>(this->_dim);
+            tbl->schema->release = nullptr;
+            tbl->array->release = nullptr;
+            if (stream->get_next(stream, tbl->array) != 0) {
+                throw runtime_error(stream->get_last_error(stream));
+            }
+            if (!tbl->array->release) { break; }  // end of the stream
+            if (stream->get_schema(stream, tbl->schema) != 0) {
+                throw runtime_error(stream->get_last_error(stream));
+            }
+            if (this->_locates) { tbl->build_index(); }
+
+            this->_fn(&state, tbl.get(), state, first);
+            first = false;
+        }
+
+        return state;
+    }
+
+private:
+    typedef void (*FnTy)(StateTy*, void*, StateTy, bool);
+    typedef void (*InitFnTy)(StateTy*);
+    typedef void (*DoneFnTy)(bool*, StateTy);
+
+    bool done(StateTy state)
+    {
+        bool is_done = false;
+        if (this->_done) { this->_done(&is_done, state); }
+        return is_done;
+    }
+
+    static Sym input_vec(shared_ptr<Func> op)
+    {
+        if (op->inputs.size() != 1 || !op->inputs[0]->type.is_vector()) {
+            throw runtime_error("Streamed functions take one vector input");
+        }
+        return op->inputs[0];
+    }
+
+    int64_t _dim;
+    bool _locates;
+    FnTy _fn;
+    InitFnTy _init;
+    DoneFnTy _done = nullptr;
+};
+
 shared_ptr<ArrowTable2> load_arrow_file(string, int64_t);
 
+// Loads only the given columns of an Arrow file, e.g. the columns that
+// ProjectPass::Columns reports for an input of a compiled query
+shared_ptr<ArrowTable2> load_arrow_file(string, int64_t, const ColumnSet&);
+
+// Loads a Parquet file, reading its row groups in parallel. Row groups whose
+// statistics place the iterator column outside `range`, e.g. the one
+// Reffine::ScanRange derives for a query, are skipped.
+shared_ptr<ArrowTable2> load_parquet_file(string, int64_t,
+                                          IterRange = IterRange{});
+
+// Loads a CSV file with a header row as a vector of type `vecty`, e.g. the
+// type of a query input. Ranges of the file are scanned in parallel and only
+// the given columns, such as those ProjectPass::Columns reports, are parsed.
+// Rows whose iterator lies outside `range` are dropped before any of their
+// other fields are parsed. Numbers may be quoted, but a quoted field may not
+// hold a line break.
+shared_ptr<ArrowTable2> load_csv_file(string, DataType vecty,
+                                      IterRange = IterRange{});
+shared_ptr<ArrowTable2> load_csv_file(string, DataType vecty, const ColumnSet&,
+                                      IterRange = IterRange{});
+
+// Streams the record batches of an Arrow IPC file as vectors, one chunk at a
+// time, for inputs too large to load at once. While the caller runs a query
+// on the current chunk, background threads keep reading up to `depth` of the
+// chunks after it.
+class ArrowFileStream {
+public:
+    ArrowFileStream(string filename, int64_t dim, size_t depth = 4);
+    ~ArrowFileStream();
+
+    // The next chunk, or nullptr after the last one
+    shared_ptr<ArrowTable2> next();
+
+private:
+    struct Impl;
+    unique_ptr<Impl> _impl;
+};
+
+// Writes vectors, e.g. query outputs, to a Parquet file if `filename` ends in
+// .parquet and to an Arrow IPC file otherwise. Each write appends a vector as
+// row groups or record batches of up to `chunk_len` rows, so the outputs of
+// a query run chunk by chunk are written out as each chunk is done. Columns
+// are encoded and compressed with `codec`, e.g. "zstd", in parallel.
+class VectorSink {
+public:
+    VectorSink(string filename, string codec = "",
+               int64_t chunk_len = 1 << 20);
+    ~VectorSink();
+
+    // The vector is written out by the time this returns
+    void write(ArrowTable*);
+    void close();
+
+private:
+    struct Impl;
+    unique_ptr<Impl> _impl;
+};
+
 #endif  // INCLUDE_REFFINE_UTILS_H_
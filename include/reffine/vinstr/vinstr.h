@@ -152,6 +152,10 @@ ArrowTable* make_vector(int64_t, uint32_t);
 
 ArrowTable* build_vector_index(ArrowTable*);
 
+void share_vector_col(ArrowTable*, uint32_t, ArrowTable*, uint32_t);
+
+void commit_vector(ArrowTable*, int64_t);
+
 }  // extern "C"
 
 #endif  // INCLUDE_REFFINE_VINSTR_H_
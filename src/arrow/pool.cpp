@@ -0,0 +1,151 @@
+#include "reffine/arrow/pool.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace std;
+using namespace reffine;
+
+void* BufferPool::alloc(size_t size)
+{
+    lock_guard<mutex> lock(this->_mutex);
+
+    // Heap buffers are anonymous mappings, so that they can be moved to a
+    // spill file in place
+    bool spilled = this->_heap_bytes >= this->_budget;
+    void* buf = MAP_FAILED;
+    if (spilled) {
+        buf = this->spill(size);
+    } else {
+        buf = mmap(nullptr, max<size_t>(size, 1), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (buf == MAP_FAILED) {
+            throw runtime_error("Cannot map buffer of " + to_string(size) +
+                                " bytes");
+        }
+    }
+    this->_buffers[buf] = {size, 0, spilled};
+
+    return buf;
+}
+
+void BufferPool::free(const void* buf)
+{
+    lock_guard<mutex> lock(this->_mutex);
+
+    // Buffers that were not allocated here come from new[]
+    auto it = this->_buffers.find(buf);
+    if (it == this->_buffers.end()) {
+        delete[] (const char*)buf;
+        return;
+    }
+
+    auto [size, used, spilled] = it->second;
+    munmap(const_cast<void*>(buf), max<size_t>(size, 1));
+    (spilled ? this->_spilled_bytes : this->_heap_bytes) -= used;
+    this->_buffers.erase(it);
+}
+
+void BufferPool::commit(const void* buf, size_t used)
+{
+    lock_guard<mutex> lock(this->_mutex);
+
+    auto it = this->_buffers.find(buf);
+    if (it == this->_buffers.end()) { return; }
+
+    auto& buffer = it->second;
+    used = min(used, buffer.size);
+    auto& bytes = buffer.spilled ? this->_spilled_bytes : this->_heap_bytes;
+    bytes = bytes - buffer.used + used;
+    buffer.used = used;
+
+    if (!buffer.spilled && this->_heap_bytes > this->_budget) {
+        this->spill_in_place(buf, buffer);
+    }
+}
+
+void BufferPool::set_budget(size_t bytes, string spill_dir)
+{
+    lock_guard<mutex> lock(this->_mutex);
+    this->_budget = bytes;
+    this->_spill_dir = spill_dir;
+}
+
+size_t BufferPool::heap_bytes()
+{
+    lock_guard<mutex> lock(this->_mutex);
+    return this->_heap_bytes;
+}
+
+size_t BufferPool::spilled_bytes()
+{
+    lock_guard<mutex> lock(this->_mutex);
+    return this->_spilled_bytes;
+}
+
+// Opens an unlinked, sparse file of `size` bytes in the spill directory
+int BufferPool::spill_file(size_t size)
+{
+    auto dir = this->_spill_dir;
+    if (dir.empty()) {
+        auto* tmpdir = getenv("TMPDIR");
+        dir = tmpdir ? tmpdir : "/tmp";
+    }
+
+    auto path = dir + "/reffine-spill-XXXXXX";
+    int fd = mkstemp(path.data());
+    if (fd < 0) { throw runtime_error("Cannot create spill file in " + dir); }
+
+    // The file goes away with the mapping
+    unlink(path.c_str());
+    if (ftruncate(fd, max<size_t>(size, 1)) != 0) {
+        close(fd);
+        throw runtime_error("Cannot grow spill file to " + to_string(size) +
+                            " bytes");
+    }
+    return fd;
+}
+
+void* BufferPool::spill(size_t size)
+{
+    int fd = this->spill_file(size);
+    size = max<size_t>(size, 1);
+    void* buf = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (buf == MAP_FAILED) {
+        throw runtime_error("Cannot map spill file of " + to_string(size) +
+                            " bytes");
+    }
+    return buf;
+}
+
+// Writes the bytes committed to a heap buffer to a spill file, then maps the
+// file over the buffer
+void BufferPool::spill_in_place(const void* buf, Buffer& buffer)
+{
+    int fd = this->spill_file(buffer.size);
+    size_t written = 0;
+    while (written < buffer.used) {
+        auto n = pwrite(fd, (const char*)buf + written, buffer.used - written,
+                        written);
+        if (n <= 0) {
+            close(fd);
+            throw runtime_error("Cannot write spill file");
+        }
+        written += n;
+    }
+
+    auto* addr = const_cast<void*>(buf);
+    void* mapped = mmap(addr, max<size_t>(buffer.size, 1),
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+    if (mapped != addr) { throw runtime_error("Cannot map spill file"); }
+
+    buffer.spilled = true;
+    this->_heap_bytes -= buffer.used;
+    this->_spilled_bytes += buffer.used;
+}
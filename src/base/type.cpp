@@ -1,5 +1,11 @@
 #include "reffine/base/type.h"
 
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+using namespace reffine;
+
 std::size_t std::hash<reffine::DataType>::operator()(
     const reffine::DataType& dt) const noexcept
 {
@@ -7,3 +13,58 @@ std::size_t std::hash<reffine::DataType>::operator()(
     for (auto dtype : dt.dtypes) { h ^= std::hash<reffine::DataType>()(dtype); }
     return h;
 }
+
+template <typename T>
+static shared_ptr<const vector<T>> intern_vec(
+    vector<T> vals, std::function<size_t(const T&)> hash_fn,
+    std::function<bool(const T&, const T&)> same_fn)
+{
+    static const auto empty = make_shared<const vector<T>>();
+    static std::mutex mutex;
+    static unordered_multimap<size_t, shared_ptr<const vector<T>>> pool;
+
+    if (vals.empty()) { return empty; }
+
+    size_t h = vals.size();
+    for (const auto& val : vals) { h = h * 31 + hash_fn(val); }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [begin, end] = pool.equal_range(h);
+    for (auto it = begin; it != end; it++) {
+        const auto& cand = *it->second;
+        if (std::equal(cand.begin(), cand.end(), vals.begin(), vals.end(),
+                       same_fn)) {
+            return it->second;
+        }
+    }
+
+    auto interned = make_shared<const vector<T>>(std::move(vals));
+    pool.emplace(h, interned);
+    return interned;
+}
+
+shared_ptr<const vector<DataType>> DataType::intern(vector<DataType> dtypes)
+{
+    // Element types are interned themselves, so two elements are identical
+    // iff they have the same base type, dim and interned vectors
+    return intern_vec<DataType>(
+        std::move(dtypes),
+        [](const DataType& dt) {
+            return std::hash<int>()(dt.btype) ^ std::hash<size_t>()(dt.dim) ^
+                   std::hash<const void*>()(dt._dtypes.get()) ^
+                   std::hash<const void*>()(dt._encodings.get());
+        },
+        [](const DataType& a, const DataType& b) {
+            return (a.btype == b.btype) && (a.dim == b.dim) &&
+                   (a._dtypes == b._dtypes) && (a._encodings == b._encodings);
+        });
+}
+
+shared_ptr<const vector<EncodeType>> DataType::intern(
+    vector<EncodeType> encodings)
+{
+    return intern_vec<EncodeType>(
+        std::move(encodings),
+        [](const EncodeType& enc) { return std::hash<int>()(enc); },
+        [](const EncodeType& a, const EncodeType& b) { return a == b; });
+}
@@ -0,0 +1,150 @@
+#include "reffine/engine/compiler.h"
+
+#include "reffine/base/log.h"
+#include "reffine/pass/canonpass.h"
+#include "reffine/pass/cemitter.h"
+#include "reffine/pass/condelimpass.h"
+#include "reffine/pass/csepass.h"
+#include "reffine/pass/fusepass.h"
+#include "reffine/pass/licmpass.h"
+#include "reffine/pass/llvmgen.h"
+#include "reffine/pass/loopgen.h"
+#include "reffine/pass/pipelinepass.h"
+#include "reffine/pass/printer2.h"
+#include "reffine/pass/readwritepass.h"
+#include "reffine/pass/scalarpass.h"
+
+using namespace reffine;
+
+shared_ptr<Func> reffine::gen_loop(shared_ptr<Func> op, bool vectorize)
+{
+    LOG(INFO) << "Reffine IR:" << std::endl << op->str() << std::endl;
+    auto op1 = PipelinePass::Build(op);
+    LOG(INFO) << "Reffine IR (pipeline):" << std::endl
+              << op1->str() << std::endl;
+    auto op2 = CondElimPass::Build(op1);
+    LOG(INFO) << "Reffine IR (condelim):" << std::endl
+              << op2->str() << std::endl;
+    auto op3 = FusePass::Build(op2);
+    LOG(INFO) << "Reffine IR (fuse):" << std::endl << op3->str() << std::endl;
+    auto op4 = CSEPass::Build(op3);
+    LOG(INFO) << "Reffine IR (cse):" << std::endl << op4->str() << std::endl;
+    auto loopgen = LoopGen(nullptr, vectorize);
+    loopgen.eval(op4);
+    return loopgen.ctx().out_func;
+}
+
+static shared_ptr<Func> lower_loop(shared_ptr<Func> loop)
+{
+    LOG(INFO) << "Loop IR (raw):" << std::endl << loop->str() << std::endl;
+    auto loop1 = CanonPass().eval(loop);
+    LOG(INFO) << "Loop IR (canon):" << std::endl << loop1->str() << std::endl;
+    auto loop2 = CondElimPass::Build(loop1);
+    LOG(INFO) << "Loop IR (condelim):" << std::endl
+              << loop2->str() << std::endl;
+    auto loop3 = ReadWritePass().eval(loop2);
+    LOG(INFO) << "Loop IR (readwrite):" << std::endl
+              << loop3->str() << std::endl;
+    auto loop4 = CSEPass::Build(loop3);
+    LOG(INFO) << "Loop IR (cse):" << std::endl << loop4->str() << std::endl;
+    auto loop5 = LICMPass::Build(loop4);
+    LOG(INFO) << "Loop IR (licm):" << std::endl << loop5->str() << std::endl;
+    auto loop6 = ScalarPass().eval(loop5);
+    LOG(INFO) << "Loop IR (scalar):" << std::endl << loop6->str() << std::endl;
+
+    return loop6;
+}
+
+unique_ptr<llvm::Module> reffine::gen_module(shared_ptr<Func> loop,
+                                             llvm::LLVMContext& llctx,
+                                             bool use_cemitter)
+{
+    auto loop3 = lower_loop(loop);
+
+    auto llmod = make_unique<llvm::Module>("__" + loop->name, llctx);
+    if (use_cemitter) {
+        auto ccode = CEmitter::Build(loop3);
+        LOG(INFO) << "C Code:" << std::endl << ccode << std::endl;
+        LLVMGen(*llmod).parse(ccode);
+    } else {
+        LLVMGen(*llmod).eval(loop3);
+    }
+    LOG(INFO) << "LLVM IR:" << std::endl
+              << IRPrinter2::Build(*llmod) << std::endl;
+
+    return llmod;
+}
+
+unique_ptr<llvm::Module> reffine::gen_multiversion_module(
+    shared_ptr<Func> loop, llvm::LLVMContext& llctx)
+{
+    auto loop3 = lower_loop(loop);
+
+    auto llmod = make_unique<llvm::Module>("__" + loop->name, llctx);
+    auto ccode = CEmitter::Build(loop3);
+    LOG(INFO) << "C Code:" << std::endl << ccode << std::endl;
+    LLVMGen(*llmod).parse_multiversion(ccode, loop->name);
+    LOG(INFO) << "LLVM IR:" << std::endl
+              << IRPrinter2::Build(*llmod) << std::endl;
+
+    return llmod;
+}
+
+ThreadSafeModule reffine::gen_module(shared_ptr<Func> loop, bool use_cemitter)
+{
+    ThreadSafeContext ctx(make_unique<llvm::LLVMContext>());
+
+    unique_ptr<llvm::Module> llmod;
+    ctx.withContextDo([&](llvm::LLVMContext* llctx) {
+        llmod = gen_module(loop, *llctx, use_cemitter);
+    });
+
+    return ThreadSafeModule(std::move(llmod), std::move(ctx));
+}
+
+CompileService* CompileService::Get()
+{
+    static unique_ptr<CompileService> service = make_unique<CompileService>();
+    return service.get();
+}
+
+ExecutorAddr CompileService::compile(shared_ptr<Func> loop, bool use_cemitter)
+{
+    auto jit = ExecEngine::Get();
+    jit->AddModule(gen_module(loop, use_cemitter));
+    return jit->LookupAddr(loop->name);
+}
+
+shared_future<ExecutorAddr> CompileService::AddLoop(shared_ptr<Func> loop,
+                                                    bool use_cemitter)
+{
+    return pool.async(
+        [this, loop, use_cemitter]() { return compile(loop, use_cemitter); });
+}
+
+shared_future<ExecutorAddr> CompileService::AddOp(shared_ptr<Func> op,
+                                                  bool vectorize)
+{
+    return pool.async([this, op, vectorize]() {
+        return compile(gen_loop(op, vectorize), true);
+    });
+}
+
+vector<shared_future<ExecutorAddr>> CompileService::AddOps(
+    vector<shared_ptr<Func>> ops, bool vectorize)
+{
+    vector<shared_future<ExecutorAddr>> addrs;
+    for (auto& op : ops) { addrs.push_back(AddOp(op, vectorize)); }
+    return addrs;
+}
+
+shared_future<shared_ptr<JITQuery>> CompileService::AddQuery(
+    shared_ptr<Func> op, bool vectorize)
+{
+    return pool.async([op, vectorize]() {
+        auto loop = gen_loop(op, vectorize);
+        return ExecEngine::Get()->AddQuery(gen_module(loop), loop->name);
+    });
+}
+
+void CompileService::Wait() { pool.wait(); }
@@ -21,33 +21,86 @@
 using namespace reffine;
 using namespace std::placeholders;
 
-ExecEngine* ExecEngine::Get()
+JITQuery::~JITQuery()
 {
-    static unique_ptr<ExecEngine> engine;
+    if (auto err = _es.removeJITDylib(_jd)) { _es.reportError(std::move(err)); }
+}
 
-    if (!engine) {
+ExecEngine::~ExecEngine()
+{
+    if (auto err = es->endSession()) { es->reportError(std::move(err)); }
+}
+
+ExecEngine* ExecEngine::Get()
+{
+    // Function-local statics are initialized exactly once even when the
+    // first calls race, e.g. from the workers of a CompileService.
+    static unique_ptr<ExecEngine> engine = []() {
         InitializeNativeTarget();
         InitializeNativeTargetAsmPrinter();
 
         auto jtmb = cantFail(JITTargetMachineBuilder::detectHost());
         auto dl = cantFail(jtmb.getDefaultDataLayoutForTarget());
 
-        engine = make_unique<ExecEngine>(std::move(jtmb), std::move(dl));
-    }
+        return make_unique<ExecEngine>(std::move(jtmb), std::move(dl));
+    }();
 
     return engine.get();
 }
 
 void ExecEngine::AddModule(unique_ptr<Module> m)
 {
-    raw_fd_ostream r(fileno(stderr), false);
-    if (verifyModule(*m, &r)) {
+    AddModule(ThreadSafeModule(std::move(m), ctx));
+}
+
+void ExecEngine::AddModule(ThreadSafeModule tsm)
+{
+    add_module(std::move(tsm), jd);
+}
+
+shared_ptr<JITQuery> ExecEngine::AddQuery(ThreadSafeModule tsm,
+                                          StringRef name)
+{
+    auto& qjd = es->createBareJITDylib("__reffine_query_" +
+                                       to_string(num_queries++));
+    qjd.addToLinkOrder(jd);
+    add_module(std::move(tsm), qjd);
+
+    auto fn_sym = cantFail(es->lookup({&qjd}, mangler(name.str())));
+    return make_shared<JITQuery>(*es, qjd, fn_sym.getAddress());
+}
+
+ExecutorAddr ExecEngine::LookupVariantAddr(StringRef name)
+{
+    for (auto isa : isa_fallbacks(host_isa())) {
+        auto fn_sym = es->lookup({&jd}, mangler(isa_symbol(name.str(), isa)));
+        if (fn_sym) { return fn_sym->getAddress(); }
+        consumeError(fn_sym.takeError());
+    }
+
+    throw std::runtime_error("No variant of " + name.str() +
+                             " runs on this host");
+}
+
+void ExecEngine::add_module(ThreadSafeModule tsm, JITDylib& dylib)
+{
+    bool failed = tsm.withModuleDo([](Module& m) {
+        raw_fd_ostream r(fileno(stderr), false);
+        return verifyModule(m, &r);
+    });
+    if (failed) {
         throw std::runtime_error("LLVM module verification failed!!!");
     } else {
-        cantFail(optimizer.add(jd, ThreadSafeModule(std::move(m), ctx)));
+        cantFail(optimizer.add(dylib, std::move(tsm)));
     }
 }
 
+ExecutorAddr ExecEngine::LookupAddr(StringRef name)
+{
+    auto fn_sym = cantFail(es->lookup({&jd}, mangler(name.str())));
+    return fn_sym.getAddress();
+}
+
 LLVMContext& ExecEngine::GetCtx()
 {
     LLVMContext* contextPtr = nullptr;
@@ -76,8 +129,11 @@ void ExecEngine::Optimize(Module& llmod) { MPM.run(llmod, MAM); }
 
 unique_ptr<ExecutionSession> ExecEngine::createExecutionSession()
 {
+    // Materialization (optimization and codegen) of independent modules is
+    // dispatched to a thread pool instead of running on the caller's thread.
     unique_ptr<SelfExecutorProcessControl> epc =
-        llvm::cantFail(SelfExecutorProcessControl::Create());
+        llvm::cantFail(SelfExecutorProcessControl::Create(
+            nullptr, make_unique<DynamicThreadPoolTaskDispatcher>(nullopt)));
     return std::make_unique<ExecutionSession>(std::move(epc));
 }
 
@@ -88,6 +144,12 @@ void ExecEngine::register_symbols()
           {ExecutorAddr::fromPtr(&make_vector), JITSymbolFlags::Callable}},
          {mangler("build_vector_index"),
           {ExecutorAddr::fromPtr(&build_vector_index),
+           JITSymbolFlags::Callable}},
+         {mangler("share_vector_col"),
+          {ExecutorAddr::fromPtr(&share_vector_col),
+           JITSymbolFlags::Callable}},
+         {mangler("commit_vector"),
+          {ExecutorAddr::fromPtr(&commit_vector),
            JITSymbolFlags::Callable}}}))));
 }
 
@@ -95,7 +157,7 @@ void ExecEngine::add_opt_passes()
 {
     // based on optimization pipeline here:
     // https://github.com/csb6/bluebird/blob/master/src/optimizer.cpp
-    VectorizerParams::VectorizationFactor = 4;
+    VectorizerParams::VectorizationFactor = isa_vector_width(host_isa());
 
     PB.registerModuleAnalyses(MAM);
     PB.registerCGSCCAnalyses(CGAM);
@@ -0,0 +1,93 @@
+#include "reffine/engine/isa.h"
+
+#include <stdexcept>
+
+using namespace reffine;
+
+ISA reffine::host_isa()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl")) {
+        return ISA::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("bmi2")) {
+        return ISA::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+        return ISA::SSE42;
+    }
+#endif
+    return ISA::GENERIC;
+}
+
+vector<ISA> reffine::isa_variants()
+{
+#if defined(__x86_64__)
+    return {ISA::AVX512, ISA::AVX2, ISA::SSE42};
+#else
+    return {ISA::GENERIC};
+#endif
+}
+
+vector<ISA> reffine::isa_fallbacks(ISA isa)
+{
+    vector<ISA> isas;
+    for (auto variant : isa_variants()) {
+        if (variant <= isa) { isas.push_back(variant); }
+    }
+    return isas;
+}
+
+string reffine::isa_name(ISA isa)
+{
+    switch (isa) {
+        case ISA::GENERIC:
+            return "generic";
+        case ISA::SSE42:
+            return "sse42";
+        case ISA::AVX2:
+            return "avx2";
+        case ISA::AVX512:
+            return "avx512";
+        default:
+            throw std::runtime_error("Invalid ISA");
+    }
+}
+
+vector<string> reffine::isa_flags(ISA isa)
+{
+    switch (isa) {
+        case ISA::GENERIC:
+            return {};
+        case ISA::SSE42:
+            return {"-march=x86-64-v2", "-mprefer-vector-width=128"};
+        case ISA::AVX2:
+            return {"-march=x86-64-v3", "-mprefer-vector-width=256"};
+        case ISA::AVX512:
+            return {"-march=x86-64-v4", "-mprefer-vector-width=512"};
+        default:
+            throw std::runtime_error("Invalid ISA");
+    }
+}
+
+unsigned reffine::isa_vector_width(ISA isa)
+{
+    switch (isa) {
+        case ISA::SSE42:
+            return 2;
+        case ISA::AVX512:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+string reffine::isa_symbol(const string& fn, ISA isa)
+{
+    return fn + "." + isa_name(isa);
+}
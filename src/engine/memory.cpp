@@ -4,13 +4,20 @@ using namespace reffine;
 
 uint32_t MemoryManager::add_builder(VectorBuilderFnTy fn)
 {
+    std::lock_guard<std::mutex> lock(this->_mutex);
     this->_builders.push_back(fn);
     return this->_builders.size() - 1;
 }
 
 ArrowTable* MemoryManager::get_table(uint32_t mem_id, int64_t len)
 {
+    std::lock_guard<std::mutex> lock(this->_mutex);
     auto tbl = this->_builders[mem_id](len);
     this->_tables.push_back(tbl);
     return tbl.get();
 }
+
+void MemoryManager::set_budget(size_t bytes, std::string spill_dir)
+{
+    bufpool.set_budget(bytes, spill_dir);
+}
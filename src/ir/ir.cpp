@@ -56,3 +56,43 @@ string ExprNode::str()
     Expr expr(const_cast<ExprNode*>(this), [](ExprNode*) {});
     return IRPrinter2::Build(expr);
 }
+
+DoneFnTy Reduce::saturation() const
+{
+    auto state = make_shared<SymNode>("tmp_state", this->type);
+    auto val = make_shared<SymNode>("tmp_val", this->vec->type.rowty());
+    auto nary = dynamic_pointer_cast<NaryExpr>(this->acc(state, val));
+    if (!nary || nary->args.size() != 2) { return nullptr; }
+
+    Expr other;
+    if (nary->arg(0) == state) {
+        other = nary->arg(1);
+    } else if (nary->arg(1) == state) {
+        other = nary->arg(0);
+    } else {
+        return nullptr;
+    }
+
+    switch (nary->op) {
+        case MathOp::OR:
+            return [](Expr s) { return s; };
+        case MathOp::AND:
+            return [](Expr s) -> Expr { return make_shared<Not>(s); };
+        case MathOp::MIN: {
+            // The first column of an Op over one iterator is the iterator, and
+            // LoopGen visits its rows in ascending order of it, so the first
+            // row that lowers the state is the minimum
+            auto op = dynamic_pointer_cast<Op>(this->vec);
+            if (!op || op->iters.size() != 1) { return nullptr; }
+            auto get = dynamic_pointer_cast<Get>(other);
+            if (!get || get->val != val || get->col != 0) { return nullptr; }
+
+            auto init = this->init;
+            return [init](Expr s) -> Expr {
+                return make_shared<Not>(make_shared<Equals>(s, init()));
+            };
+        }
+        default:
+            return nullptr;
+    }
+}
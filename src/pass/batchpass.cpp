@@ -0,0 +1,150 @@
+#include "reffine/pass/batchpass.h"
+
+#include <set>
+
+#include "reffine/builder/reffiner.h"
+#include "reffine/pass/base/irpass.h"
+#include "reffine/pass/fusepass.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+// Symbols an expression refers to, without following their definitions
+class SymCollector : public IRPass {
+public:
+    SymCollector() : IRPass(make_unique<IRPassCtx>()) {}
+
+    set<SymNode*> syms;
+
+private:
+    void Visit(SymNode& sym) final { this->syms.insert(&sym); }
+};
+
+// Maps the captured symbols in the result of a Reduce function to their
+// batched counterparts. The symbols of the arguments passed to the function
+// by LoopGen are kept.
+class CaptureMap : public IRClone {
+public:
+    static Expr Build(Expr expr, const map<Sym, Sym>& captures,
+                      vector<Expr> args = {})
+    {
+        shared_ptr<Func> func = _func("", nullptr, vector<Sym>{});
+        CaptureMap pass(make_unique<IRGenCtx>(*func, func));
+        for (auto& arg : args) {
+            SymCollector collector;
+            arg->Accept(collector);
+            for (auto* sym : collector.syms) {
+                // The argument owns the symbols it refers to
+                Sym arg_sym(arg, sym);
+                pass.map_sym(arg_sym, arg_sym);
+            }
+        }
+        for (auto& [old_sym, new_sym] : captures) {
+            pass.map_sym(old_sym, new_sym);
+        }
+
+        return pass.eval(expr);
+    }
+
+private:
+    explicit CaptureMap(unique_ptr<IRGenCtx> ctx) : IRClone(std::move(ctx))
+    {
+        this->_reuse_syms = true;
+    }
+};
+
+Expr BatchPass::visit(Sym old_sym)
+{
+    // Queries built from the same code use the same names
+    return _sym(old_sym->name + "_q" + to_string(this->_query), old_sym);
+}
+
+Expr BatchPass::visit(Reduce& red)
+{
+    auto new_red = static_pointer_cast<Reduce>(IRClone::visit(red));
+
+    // The map is complete by the time LoopGen calls the functions
+    auto captures = this->_captures;
+    auto init = red.init;
+    auto acc = red.acc;
+    auto done = red.done;
+    new_red->init = [captures, init]() {
+        return CaptureMap::Build(init(), *captures);
+    };
+    new_red->acc = [captures, acc](Expr state, Expr val) {
+        return CaptureMap::Build(acc(state, val), *captures, {state, val});
+    };
+    if (done) {
+        new_red->done = [captures, done](Expr state) {
+            return CaptureMap::Build(done(state), *captures, {state});
+        };
+    }
+
+    return new_red;
+}
+
+shared_ptr<Func> BatchPass::Build(const vector<shared_ptr<Func>>& funcs,
+                                  string name)
+{
+    if (funcs.empty()) { throw runtime_error("No functions to batch"); }
+
+    auto vec_inputs = [](Func& func) {
+        vector<Sym> vecs;
+        for (auto& input : func.inputs) {
+            if (input->type.is_vector()) { vecs.push_back(input); }
+        }
+        return vecs;
+    };
+
+    auto vecs = vec_inputs(*funcs[0]);
+    for (auto& func : funcs) {
+        auto func_vecs = vec_inputs(*func);
+        bool same_vecs = (func_vecs.size() == vecs.size());
+        for (size_t k = 0; same_vecs && k < vecs.size(); k++) {
+            same_vecs = (func_vecs[k]->type == vecs[k]->type);
+        }
+        if (!same_vecs) {
+            throw runtime_error("Input vectors of " + func->name +
+                                " differ from those of " + funcs[0]->name);
+        }
+    }
+
+    BatchPass pass;
+    auto new_func = _func(name, nullptr, vector<Sym>{});
+    for (auto& vec : vecs) { new_func->inputs.push_back(_sym(vec->name, vec)); }
+
+    // Scalar inputs shared by several queries are passed once
+    SymMap params;
+
+    vector<Expr> outputs;
+    for (size_t i = 0; i < funcs.size(); i++) {
+        auto new_ctx = make_unique<IRGenCtx>(*funcs[i], new_func);
+        pass.switch_ctx(new_ctx);
+        pass._query = i;
+        pass._captures = make_shared<SymMap>();
+
+        size_t k = 0;
+        for (auto& input : funcs[i]->inputs) {
+            if (input->type.is_vector()) {
+                pass.map_sym(input, new_func->inputs[k++]);
+                continue;
+            }
+            if (!params.contains(input)) {
+                params[input] = static_pointer_cast<SymNode>(pass.visit(input));
+                new_func->inputs.push_back(params.at(input));
+            }
+            pass.map_sym(input, params.at(input));
+        }
+        outputs.push_back(pass.eval(funcs[i]->output));
+
+        // Symbols that are only captured by Reduce functions are not reached
+        // from the output
+        for (auto& [sym, def] : funcs[i]->tbl) { pass.eval(sym); }
+        for (auto& [old_sym, new_sym] : pass.ctx().sym_sym_map) {
+            (*pass._captures)[old_sym] = new_sym;
+        }
+    }
+    new_func->output = _new(outputs);
+
+    return FusePass::Build(new_func);
+}
@@ -0,0 +1,374 @@
+#include "reffine/pass/condelimpass.h"
+
+#include <sstream>
+
+#include "reffine/builder/reffiner.h"
+#include "reffine/pass/base/irpass.h"
+#include "reffine/pass/z3solver.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+static const unsigned SOLVER_TIMEOUT_MS = 200;
+
+// Calls that read vectors or arrays but never write them
+static const set<string> READ_ONLY_CALLS = {
+    "vector_locate", "get_null_bit",   "get_vector_array", "get_array_child",
+    "get_array_buf", "get_array_len",  "read_runend_buf",  "get_vector_len",
+};
+
+static const set<MathOp> SOLVER_OPS = {
+    MathOp::ADD, MathOp::SUB, MathOp::MUL, MathOp::MAX, MathOp::MIN,
+    MathOp::ABS, MathOp::NEG, MathOp::LT,  MathOp::LTE, MathOp::GT,
+    MathOp::GTE, MathOp::EQ,  MathOp::NOT, MathOp::AND, MathOp::OR,
+};
+
+class MemAnalysis : public IRPass {
+public:
+    explicit MemAnalysis(const SymTable& tbl)
+        : IRPass(make_unique<IRPassCtx>(tbl))
+    {
+    }
+
+    MemAccess reads;
+    MemAccess writes;
+
+private:
+    void Visit(SymNode& sym) final
+    {
+        if (this->ctx().in_sym_tbl.contains(this->tmp_sym(sym))) {
+            IRPass::Visit(sym);
+        }
+    }
+
+    void Visit(Load& e) final
+    {
+        access(reads, e.addr);
+        IRPass::Visit(e);
+    }
+
+    void Visit(Store& e) final
+    {
+        access(writes, e.addr);
+        IRPass::Visit(e);
+    }
+
+    void Visit(AtomicOp& e) final
+    {
+        access(writes, e.addr);
+        IRPass::Visit(e);
+    }
+
+    void Visit(ReadData& e) final
+    {
+        reads.heap = true;
+        IRPass::Visit(e);
+    }
+
+    void Visit(ReadBit& e) final
+    {
+        reads.heap = true;
+        IRPass::Visit(e);
+    }
+
+    void Visit(ReadRunEnd& e) final
+    {
+        reads.heap = true;
+        IRPass::Visit(e);
+    }
+
+    void Visit(Length& e) final
+    {
+        reads.heap = true;
+        IRPass::Visit(e);
+    }
+
+    void Visit(WriteData& e) final
+    {
+        writes.heap = true;
+        IRPass::Visit(e);
+    }
+
+    void Visit(WriteBit& e) final
+    {
+        writes.heap = true;
+        IRPass::Visit(e);
+    }
+
+    void Visit(Call& e) final
+    {
+        reads.heap = true;
+        if (!READ_ONLY_CALLS.contains(e.name)) { writes.all = true; }
+        IRPass::Visit(e);
+    }
+
+    void access(MemAccess& acc, Expr addr)
+    {
+        auto sym = dynamic_pointer_cast<SymNode>(addr);
+        if (sym && this->ctx().in_sym_tbl.contains(sym) &&
+            dynamic_pointer_cast<Alloc>(this->ctx().in_sym_tbl.at(sym))) {
+            acc.allocs.insert(sym.get());
+        } else {
+            acc.heap = true;
+        }
+    }
+};
+
+static bool is_solvable(const DataType& type)
+{
+    return type.is_int() || type.is_idx() || type == types::BOOL;
+}
+
+const string& CondElimPass::key(Expr expr)
+{
+    if (this->_keys.contains(expr.get())) { return this->_keys.at(expr.get()); }
+
+    vector<Expr> args;
+    stringstream ss;
+    if (auto sym = dynamic_pointer_cast<SymNode>(expr)) {
+        ss << "s" << sym.get();
+    } else if (auto cnst = dynamic_pointer_cast<Const>(expr)) {
+        ss << "c" << cnst->type.str() << ":" << hexfloat << cnst->val;
+    } else if (auto nary = dynamic_pointer_cast<NaryExpr>(expr)) {
+        ss << "n" << (int)nary->op;
+        args = nary->args;
+    } else if (auto load = dynamic_pointer_cast<Load>(expr)) {
+        ss << "l";
+        args = {load->addr, load->offset};
+    } else if (auto read = dynamic_pointer_cast<ReadData>(expr)) {
+        ss << "r" << read->col;
+        args = {read->vec, read->idx};
+    } else if (auto bit = dynamic_pointer_cast<ReadBit>(expr)) {
+        ss << "b" << bit->col;
+        args = {bit->vec, bit->idx};
+    } else if (auto len = dynamic_pointer_cast<Length>(expr)) {
+        ss << "len" << len->col;
+        args = {len->vec};
+    } else if (auto in = dynamic_pointer_cast<In>(expr)) {
+        ss << "in";
+        args = {in->iter, in->vec};
+    } else if (auto call = dynamic_pointer_cast<Call>(expr)) {
+        ss << "f" << call->name;
+        args = call->args;
+    } else if (auto cast = dynamic_pointer_cast<Cast>(expr)) {
+        ss << "t" << cast->type.str();
+        args = {cast->arg};
+    } else if (auto get = dynamic_pointer_cast<Get>(expr)) {
+        ss << "g" << get->col;
+        args = {get->val};
+    } else {
+        // Never equal to any other expression
+        ss << "x" << expr.get();
+    }
+    for (auto& arg : args) { ss << "(" << key(arg) << ")"; }
+
+    this->_keys[expr.get()] = ss.str();
+    return this->_keys.at(expr.get());
+}
+
+Expr CondElimPass::abstract(Expr expr)
+{
+    if (auto sym = dynamic_pointer_cast<SymNode>(expr)) {
+        if (this->ctx().in_sym_tbl.contains(sym)) {
+            auto val = this->ctx().in_sym_tbl.at(sym);
+            if (dynamic_pointer_cast<NaryExpr>(val) ||
+                dynamic_pointer_cast<Const>(val) ||
+                dynamic_pointer_cast<SymNode>(val)) {
+                return abstract(val);
+            }
+        }
+    } else if (auto cnst = dynamic_pointer_cast<Const>(expr)) {
+        if (is_solvable(cnst->type)) { return cnst; }
+    } else if (auto nary = dynamic_pointer_cast<NaryExpr>(expr)) {
+        bool solvable =
+            SOLVER_OPS.contains(nary->op) && is_solvable(nary->type);
+        for (auto& arg : nary->args) {
+            solvable = solvable && is_solvable(arg->type);
+        }
+
+        if (solvable) {
+            vector<Expr> args;
+            for (auto& arg : nary->args) { args.push_back(abstract(arg)); }
+            return _nary(nary->type, nary->op, args);
+        }
+    }
+
+    // Anything else is an unknown, but equal expressions share a variable
+    auto& expr_key = key(expr);
+    if (!this->_vars.contains(expr_key)) {
+        auto var = _sym("v" + to_string(this->_vars.size()), expr->type);
+        this->_vars[expr_key] = var;
+    }
+    return this->_vars.at(expr_key);
+}
+
+bool CondElimPass::refute(Expr cond)
+{
+    Expr conj = abstract(cond);
+    for (auto& [fact, holds] : this->_facts) {
+        auto val = abstract(fact);
+        conj = _and(conj, holds ? val : _not(val));
+    }
+
+    try {
+        Z3Solver solver(this->_z3ctx);
+        solver.set_timeout(SOLVER_TIMEOUT_MS);
+        return solver.refute(conj);
+    } catch (const z3::exception&) {
+        return false;
+    } catch (const runtime_error&) {
+        return false;
+    }
+}
+
+bool CondElimPass::prove(Expr cond) { return refute(_not(cond)); }
+
+const MemAccess& CondElimPass::reads(Expr expr)
+{
+    if (!this->_reads.contains(expr.get())) {
+        MemAnalysis mem(this->ctx().in_sym_tbl);
+        expr->Accept(mem);
+        this->_reads[expr.get()] = mem.reads;
+        this->_writes[expr.get()] = mem.writes;
+    }
+
+    return this->_reads.at(expr.get());
+}
+
+const MemAccess& CondElimPass::writes(Expr expr)
+{
+    reads(expr);
+    return this->_writes.at(expr.get());
+}
+
+void CondElimPass::kill_facts(const MemAccess& w)
+{
+    erase_if(this->_facts, [&](const pair<Expr, bool>& fact) {
+        auto& r = reads(fact.first);
+        if (w.all || (w.heap && r.heap)) { return true; }
+        for (auto* alloc : r.allocs) {
+            if (w.allocs.contains(alloc)) { return true; }
+        }
+        return false;
+    });
+}
+
+Expr CondElimPass::visit(NaryExpr& e)
+{
+    if (e.op != MathOp::AND || this->_facts.empty()) {
+        return IRClone::visit(e);
+    }
+
+    vector<Expr> conjs;
+    function<void(Expr)> flatten = [&](Expr expr) {
+        auto nary = dynamic_pointer_cast<NaryExpr>(expr);
+        if (nary && nary->op == MathOp::AND) {
+            for (auto& arg : nary->args) { flatten(arg); }
+        } else {
+            conjs.push_back(expr);
+        }
+    };
+    flatten(this->tmp_expr(e));
+
+    // Drop the conjuncts that already follow from the guards
+    Expr new_expr = nullptr;
+    for (auto& conj : conjs) {
+        if (prove(conj)) { continue; }
+        auto new_conj = eval(conj);
+        new_expr = new_expr ? _and(new_expr, new_conj) : new_conj;
+    }
+
+    return new_expr ? new_expr : _true();
+}
+
+Expr CondElimPass::visit(Select& e)
+{
+    // Both sides of a select are evaluated, so the condition is not added
+    // to the facts of either side
+    if (prove(e.cond)) { return eval(e.true_body); }
+    if (refute(e.cond)) { return eval(e.false_body); }
+
+    return IRClone::visit(e);
+}
+
+Expr CondElimPass::visit(IfElse& e)
+{
+    if (prove(e.cond)) { return eval(e.true_body); }
+    if (refute(e.cond)) {
+        return e.false_body ? eval(e.false_body) : _noop();
+    }
+
+    auto cond = eval(e.cond);
+    auto facts = this->_facts;
+
+    this->_facts.push_back({e.cond, true});
+    auto true_body = eval(e.true_body);
+    this->_facts = facts;
+
+    this->_facts.push_back({e.cond, false});
+    auto false_body = e.false_body ? eval(e.false_body) : nullptr;
+    this->_facts = facts;
+
+    kill_facts(writes(this->tmp_expr(e)));
+
+    return _ifelse(cond, true_body, false_body);
+}
+
+Expr CondElimPass::visit(Stmts& s)
+{
+    vector<Expr> stmts;
+    for (auto& stmt : s.stmts) {
+        stmts.push_back(eval(stmt));
+        kill_facts(writes(stmt));
+    }
+
+    return _stmts(stmts);
+}
+
+Expr CondElimPass::visit(Loop& loop)
+{
+    // Facts from outside the loop must hold on every iteration
+    kill_facts(writes(this->tmp_expr(loop)));
+    auto facts = this->_facts;
+
+    auto init = loop.init ? eval(loop.init) : nullptr;
+    auto exit_cond = eval(loop.exit_cond);
+
+    // The body only runs while the exit condition does not hold
+    this->_facts.push_back({loop.exit_cond, false});
+    auto body_cond = loop.body_cond ? eval(loop.body_cond) : nullptr;
+    if (loop.body_cond) { this->_facts.push_back({loop.body_cond, true}); }
+    auto body = loop.body ? eval(loop.body) : nullptr;
+    this->_facts = facts;
+
+    auto incr = loop.incr ? eval(loop.incr) : nullptr;
+
+    this->_facts.push_back({loop.exit_cond, true});
+    auto post = loop.post ? eval(loop.post) : nullptr;
+    this->_facts = facts;
+
+    auto new_loop = _loop(eval(loop.output));
+    new_loop->init = init;
+    new_loop->incr = incr;
+    new_loop->exit_cond = exit_cond;
+    new_loop->body_cond = body_cond;
+    new_loop->body = body;
+    new_loop->post = post;
+
+    return new_loop;
+}
+
+Expr CondElimPass::visit(Reduce& red)
+{
+    // A reduction over an op that selects nothing is its initial value
+    if (auto op = dynamic_pointer_cast<Op>(red.vec)) {
+        if (refute(op->pred)) { return eval(red.init()); }
+    }
+
+    return IRClone::visit(red);
+}
+
+shared_ptr<Func> CondElimPass::Build(shared_ptr<Func> func)
+{
+    return static_pointer_cast<Func>(CondElimPass().eval(func));
+}
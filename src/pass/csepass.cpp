@@ -0,0 +1,245 @@
+#include "reffine/pass/csepass.h"
+
+#include <sstream>
+
+#include "reffine/builder/reffiner.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+static const set<string> PURE_CALLS = {
+    "vector_locate",
+    "get_vector_array",
+    "get_array_child",
+    "get_array_buf",
+};
+
+static const set<MathOp> PURE_OPS = {
+    MathOp::ADD, MathOp::SUB,  MathOp::MUL,  MathOp::NEG,   MathOp::ABS,
+    MathOp::MAX, MathOp::MIN,  MathOp::SQRT, MathOp::CEIL,  MathOp::FLOOR,
+    MathOp::POW,
+};
+
+const CSEPass::ExprKey& CSEPass::key(Expr expr)
+{
+    if (this->_keys.contains(expr.get())) { return this->_keys.at(expr.get()); }
+
+    vector<Expr> args;
+    stringstream ss;
+    bool hazard = false;
+    if (auto sym = dynamic_pointer_cast<SymNode>(expr)) {
+        ss << "s" << sym.get();
+    } else if (auto cnst = dynamic_pointer_cast<Const>(expr)) {
+        ss << "c" << cnst->type.str() << ":" << hexfloat << cnst->val;
+    } else if (auto nary = dynamic_pointer_cast<NaryExpr>(expr)) {
+        if (PURE_OPS.contains(nary->op)) {
+            ss << "n" << (int)nary->op << ":" << nary->type.str();
+            args = nary->args;
+        }
+    } else if (auto get = dynamic_pointer_cast<Get>(expr)) {
+        ss << "g" << get->col;
+        args = {get->val};
+    } else if (auto cast = dynamic_pointer_cast<Cast>(expr)) {
+        ss << "t" << cast->type.str();
+        args = {cast->arg};
+    } else if (auto elem = dynamic_pointer_cast<Element>(expr)) {
+        // Elements of nested vectors are subvectors consumed by LoopGen
+        if (!elem->type.is_vector()) {
+            ss << "e";
+            args = {elem->vec, elem->iter};
+            hazard = !this->_safe_elems.contains(
+                {elem->vec.get(), elem->iter.get()});
+        }
+    } else if (auto call = dynamic_pointer_cast<Call>(expr)) {
+        if (PURE_CALLS.contains(call->name)) {
+            ss << "f" << call->name;
+            args = call->args;
+        }
+    } else if (auto read = dynamic_pointer_cast<ReadData>(expr)) {
+        ss << "r" << read->col;
+        args = {read->vec, read->idx};
+        hazard = true;
+    }
+
+    ExprKey res{ss.str(), hazard};
+    for (auto& arg : args) {
+        auto& arg_key = key(arg);
+        if (arg_key.key.empty()) {
+            res.key = "";
+            break;
+        }
+        res.key += "(" + arg_key.key + ")";
+        res.hazard |= arg_key.hazard;
+    }
+    if (!dynamic_pointer_cast<SymNode>(expr) &&
+        !dynamic_pointer_cast<Const>(expr) && args.empty()) {
+        res.key = "";
+    }
+
+    this->_keys[expr.get()] = res;
+    return this->_keys.at(expr.get());
+}
+
+Expr CSEPass::share(ExprNode& expr, function<Expr()> clone)
+{
+    auto& expr_key = key(this->tmp_expr(expr));
+    if (expr_key.key.empty()) { return clone(); }
+
+    ScopedKey skey = {this->_scopes.back(), expr_key.key};
+    if (this->_counting) {
+        this->_counts[skey]++;
+        if (expr_key.hazard && this->_guards > 0) {
+            this->_hazards.insert(skey);
+        }
+        return clone();
+    }
+
+    if (this->_counts[skey] < 2 || this->_hazards.contains(skey)) {
+        return clone();
+    }
+    if (!this->_shared.contains(skey)) {
+        auto val = clone();
+        auto sym = val->symify("cse");
+        this->assign(sym, val);
+        this->_shared[skey] = sym;
+    }
+
+    return this->_shared.at(skey);
+}
+
+Expr CSEPass::eval_in(Expr expr, Scope scope)
+{
+    if (!expr) { return nullptr; }
+
+    this->_scopes.push_back(scope);
+    auto res = eval(expr);
+    this->_scopes.pop_back();
+
+    return res;
+}
+
+Expr CSEPass::eval_guarded(Expr expr)
+{
+    this->_guards++;
+    auto res = eval(expr);
+    this->_guards--;
+
+    return res;
+}
+
+void CSEPass::collect_safe_elems(Expr pred)
+{
+    if (auto sym = dynamic_pointer_cast<SymNode>(pred)) {
+        if (this->ctx().in_sym_tbl.contains(sym)) {
+            collect_safe_elems(this->ctx().in_sym_tbl.at(sym));
+        }
+    } else if (auto in = dynamic_pointer_cast<In>(pred)) {
+        this->_safe_elems.insert({in->vec.get(), in->iter.get()});
+    } else if (auto nary = dynamic_pointer_cast<NaryExpr>(pred)) {
+        if (nary->op == MathOp::AND) {
+            for (auto& arg : nary->args) { collect_safe_elems(arg); }
+        }
+    }
+}
+
+Expr CSEPass::visit(NaryExpr& e)
+{
+    if (e.op == MathOp::AND || e.op == MathOp::OR) {
+        // The second operand may only be evaluated depending on the first
+        return _nary(e.type, e.op,
+                     vector<Expr>{eval(e.arg(0)), eval_guarded(e.arg(1))});
+    }
+
+    return share(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr CSEPass::visit(Get& e)
+{
+    return share(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr CSEPass::visit(Cast& e)
+{
+    return share(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr CSEPass::visit(Element& e)
+{
+    return share(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr CSEPass::visit(Call& e)
+{
+    return share(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr CSEPass::visit(ReadData& e)
+{
+    return share(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr CSEPass::visit(Select& e)
+{
+    return _sel(eval(e.cond), eval_guarded(e.true_body),
+                eval_guarded(e.false_body));
+}
+
+Expr CSEPass::visit(IfElse& e)
+{
+    auto cond = eval(e.cond);
+
+    this->_guards++;
+    auto true_body = eval_in(e.true_body, {&e, 0});
+    auto false_body = eval_in(e.false_body, {&e, 1});
+    this->_guards--;
+
+    return _ifelse(cond, true_body, false_body);
+}
+
+Expr CSEPass::visit(Op& op)
+{
+    // Elements of the vectors that the op iterates over always exist
+    auto safe_elems = this->_safe_elems;
+    collect_safe_elems(op.pred);
+
+    this->_scopes.push_back({&op, 0});
+    auto new_op = IRClone::visit(op);
+    this->_scopes.pop_back();
+
+    this->_safe_elems = safe_elems;
+
+    return new_op;
+}
+
+Expr CSEPass::visit(Loop& loop)
+{
+    // The header (exit_cond) dominates body_cond and incr, which in turn
+    // dominate the body unless it is only run when body_cond holds
+    auto new_loop = _loop(eval_in(loop.output, {&loop, 0}));
+
+    new_loop->init = eval_in(loop.init, {&loop, 1});
+    new_loop->exit_cond = eval_in(loop.exit_cond, {&loop, 2});
+    new_loop->body_cond = eval_in(loop.body_cond, {&loop, 2});
+    if (loop.body_cond) {
+        this->_guards++;
+        new_loop->body = eval_in(loop.body, {&loop, 3});
+        this->_guards--;
+    } else {
+        new_loop->body = eval_in(loop.body, {&loop, 2});
+    }
+    new_loop->incr = eval_in(loop.incr, {&loop, 2});
+    new_loop->post = eval_in(loop.post, {&loop, 4});
+
+    return new_loop;
+}
+
+shared_ptr<Func> CSEPass::Build(shared_ptr<Func> func)
+{
+    CSEPass counter(true);
+    counter.eval(func);
+
+    CSEPass cse(false);
+    cse._counts = std::move(counter._counts);
+    cse._hazards = std::move(counter._hazards);
+    return static_pointer_cast<Func>(cse.eval(func));
+}
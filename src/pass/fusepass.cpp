@@ -0,0 +1,416 @@
+#include "reffine/pass/fusepass.h"
+
+#include "reffine/builder/reffiner.h"
+#include "reffine/pass/base/irpass.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+// Symbols of a function table that an expression depends on, including those
+// captured by the init and acc functions of reductions
+class DepAnalysis : public IRPass {
+public:
+    static set<Sym> Build(const SymTable& tbl, Expr expr)
+    {
+        DepAnalysis pass(tbl);
+        expr->Accept(pass);
+
+        set<Sym> deps;
+        for (auto& [sym, _] : pass.ctx().out_sym_tbl) { deps.insert(sym); }
+        return deps;
+    }
+
+private:
+    explicit DepAnalysis(const SymTable& tbl)
+        : IRPass(make_unique<IRPassCtx>(tbl))
+    {
+    }
+
+    void Visit(SymNode& symbol) final
+    {
+        // Inputs and iterators have no definition to follow
+        auto sym = this->tmp_sym(symbol);
+        if (this->ctx().in_sym_tbl.contains(sym)) { IRPass::Visit(symbol); }
+    }
+
+    void Visit(Reduce& red) final
+    {
+        IRPass::Visit(red);
+
+        auto state = red.init();
+        auto val = make_shared<SymNode>("tmp_val", red.vec->type.rowty());
+        state->Accept(*this);
+        red.acc(state, val)->Accept(*this);
+    }
+};
+
+static void flatten_and(Expr e, vector<Expr>& conjuncts)
+{
+    auto nary = dynamic_pointer_cast<NaryExpr>(e);
+    if (nary && nary->op == MathOp::AND) {
+        for (auto& arg : nary->args) { flatten_and(arg, conjuncts); }
+    } else {
+        conjuncts.push_back(e);
+    }
+}
+
+static bool is_scan(Expr e, const vector<Sym>& iters)
+{
+    auto in = dynamic_pointer_cast<In>(e);
+    return in && find(iters.begin(), iters.end(), in->iter) != iters.end();
+}
+
+static string ptr_key(Expr e)
+{
+    return "@" + to_string(reinterpret_cast<uintptr_t>(e.get()));
+}
+
+// Structural key of the vector a reduction reads. Symbols and anything but
+// arithmetic, constants, elements and subvectors compare by identity.
+static string vec_key(Expr e)
+{
+    if (auto subvec = dynamic_pointer_cast<SubVector>(e)) {
+        return "subvec(" + vec_key(subvec->vec) + "," +
+               vec_key(subvec->start) + "," + vec_key(subvec->end) + ")";
+    } else if (auto elem = dynamic_pointer_cast<Element>(e)) {
+        return "elem(" + vec_key(elem->vec) + "," + vec_key(elem->iter) + ")";
+    } else if (auto nary = dynamic_pointer_cast<NaryExpr>(e)) {
+        string key = "nary" + to_string((int)nary->op) + "(";
+        for (auto& arg : nary->args) { key += vec_key(arg) + ","; }
+        return key + ")";
+    } else if (auto cnst = dynamic_pointer_cast<Const>(e)) {
+        return cnst->type.str() + ":" + cnst->str();
+    } else {
+        return ptr_key(e);
+    }
+}
+
+static const set<MathOp> SAFE_OPS = {
+    MathOp::ADD, MathOp::SUB,  MathOp::MUL,  MathOp::MAX,   MathOp::MIN,
+    MathOp::NEG, MathOp::ABS,  MathOp::SQRT, MathOp::CEIL,  MathOp::FLOOR,
+    MathOp::POW, MathOp::LT,   MathOp::LTE,  MathOp::GT,    MathOp::GTE,
+    MathOp::EQ,  MathOp::NOT,  MathOp::AND,  MathOp::OR,
+};
+
+// Whether `e` can be evaluated for any row `op` scans, and not only for the
+// rows its predicate selects: it does not divide, and only reads elements of
+// the vectors `op` scans at the rows it scans
+static bool row_safe(Expr e, const Op& op, const SymTable& tbl)
+{
+    if (auto sym = dynamic_pointer_cast<SymNode>(e)) {
+        return !tbl.contains(sym) || row_safe(tbl.at(sym), op, tbl);
+    } else if (dynamic_pointer_cast<Const>(e)) {
+        return true;
+    } else if (auto nary = dynamic_pointer_cast<NaryExpr>(e)) {
+        if (!SAFE_OPS.contains(nary->op)) { return false; }
+        return all_of(nary->args.begin(), nary->args.end(),
+                      [&](Expr arg) { return row_safe(arg, op, tbl); });
+    } else if (auto get = dynamic_pointer_cast<Get>(e)) {
+        return row_safe(get->val, op, tbl);
+    } else if (auto cast = dynamic_pointer_cast<Cast>(e)) {
+        return row_safe(cast->arg, op, tbl);
+    } else if (auto sel = dynamic_pointer_cast<Select>(e)) {
+        return row_safe(sel->cond, op, tbl) &&
+               row_safe(sel->true_body, op, tbl) &&
+               row_safe(sel->false_body, op, tbl);
+    } else if (auto elem = dynamic_pointer_cast<Element>(e)) {
+        vector<Expr> conjuncts;
+        flatten_and(op.pred, conjuncts);
+        for (auto& conj : conjuncts) {
+            if (!is_scan(conj, op.iters)) { continue; }
+            auto in = static_pointer_cast<In>(conj);
+            if (in->iter == elem->iter && in->vec == elem->vec) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Whether the outputs and conditions of `op` can be evaluated for rows that
+// only another member of its group selects. Scans are shared by the whole
+// group, so an Op that only scans always can.
+static bool fusable(const Op& op, const SymTable& tbl)
+{
+    vector<Expr> conjuncts;
+    flatten_and(op.pred, conjuncts);
+    auto filters = [&op](Expr conj) { return !is_scan(conj, op.iters); };
+    if (none_of(conjuncts.begin(), conjuncts.end(), filters)) { return true; }
+
+    for (auto& conj : conjuncts) {
+        if (filters(conj) && !row_safe(conj, op, tbl)) { return false; }
+    }
+    return all_of(op.outputs.begin(), op.outputs.end(),
+                  [&](Expr output) { return row_safe(output, op, tbl); });
+}
+
+// Identifies the rows an Op scans by its iterator types and the vectors it
+// scans. Empty if the Op does not scan any vector.
+static string scan_key(const Op& op)
+{
+    string key;
+    for (auto& iter : op.iters) { key += iter->type.str() + ";"; }
+
+    vector<Expr> conjuncts;
+    flatten_and(op.pred, conjuncts);
+    bool scans = false;
+    for (auto& conj : conjuncts) {
+        if (!is_scan(conj, op.iters)) { continue; }
+
+        auto in = static_pointer_cast<In>(conj);
+        auto iter = find(op.iters.begin(), op.iters.end(), in->iter);
+        key += "in(" + to_string(iter - op.iters.begin()) + "," +
+               ptr_key(in->vec) + ");";
+        scans = true;
+    }
+
+    return scans ? key : "";
+}
+
+Expr FusePass::visit(Reduce& red)
+{
+    auto it = this->_members.find(&red);
+    if (it == this->_members.end()) { return IRClone::visit(red); }
+
+    auto [g, j] = it->second;
+    auto& group = this->_groups[g];
+    auto& member = group.members[j];
+    member.used = true;
+
+    if (group.iters.empty()) {
+        auto vec = eval(red.vec);
+        if (!group.vec) { group.vec = vec; }
+    } else {
+        // Members of a group iterate with the same symbols
+        auto& op = static_cast<Op&>(*red.vec);
+        for (size_t k = 0; k < op.iters.size(); k++) {
+            this->map_sym(op.iters[k], group.iters[k]);
+        }
+        member.pred = eval(op.pred);
+        for (auto& output : op.outputs) {
+            member.outputs.push_back(eval(output));
+        }
+    }
+
+    return _get(group.sym, j);
+}
+
+void FusePass::group(Func& func)
+{
+    vector<Group> groups;
+    map<string, vector<size_t>> keyed_groups;
+    set<ExprNode*> seen;
+
+    for (auto& [sym, def] : func.tbl) {
+        auto red = dynamic_pointer_cast<Reduce>(def);
+        if (!red || seen.contains(red.get())) { continue; }
+        seen.insert(red.get());
+
+        string key;
+        auto op = dynamic_pointer_cast<Op>(red->vec);
+        if (op) {
+            key = scan_key(*op);
+            if (key.empty() || !fusable(*op, func.tbl)) { continue; }
+            key = "op;" + key;
+        } else {
+            key = "vec;" + vec_key(red->vec);
+        }
+
+        Member member{sym, red, DepAnalysis::Build(func.tbl, red), false,
+                      nullptr, {}};
+        auto independent = [&groups, &member](size_t g) {
+            for (auto& other : groups[g].members) {
+                if (member.deps.contains(other.sym) ||
+                    other.deps.contains(member.sym)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        auto& candidates = keyed_groups[key];
+        auto g = find_if(candidates.begin(), candidates.end(), independent);
+        if (g == candidates.end()) {
+            candidates.push_back(groups.size());
+            g = prev(candidates.end());
+
+            Group group;
+            if (op) {
+                for (auto& iter : op->iters) {
+                    group.iters.push_back(_sym(iter->name, iter));
+                }
+            }
+            groups.push_back(group);
+        }
+        groups[*g].members.push_back(member);
+    }
+
+    for (auto& group : groups) {
+        if (group.members.size() < 2) { continue; }
+
+        vector<Expr> states;
+        for (size_t j = 0; j < group.members.size(); j++) {
+            auto& red = group.members[j].red;
+            this->_members[red.get()] = {this->_groups.size(), j};
+            states.push_back(red->init());
+        }
+        group.sym = _new(states)->symify("_fused");
+
+        this->_groups.push_back(group);
+    }
+}
+
+shared_ptr<Reduce> FusePass::fuse(Group& group, SymTable& tbl)
+{
+    // Members that are not used keep their initial state
+    vector<shared_ptr<Reduce>> reds;
+    vector<bool> used;
+    for (auto& member : group.members) {
+        reds.push_back(member.red);
+        used.push_back(member.used);
+    }
+
+    auto init = [reds]() {
+        vector<Expr> states;
+        for (auto& red : reds) { states.push_back(red->init()); }
+        return _new(states);
+    };
+
+    // The fused reduction is done once every used member is
+    DoneFnTy done;
+    bool members_done = true;
+    for (size_t j = 0; j < reds.size(); j++) {
+        members_done &= (!used[j] || reds[j]->done != nullptr);
+    }
+    if (members_done) {
+        done = [reds, used](Expr s) {
+            Expr all;
+            for (size_t j = 0; j < reds.size(); j++) {
+                if (!used[j]) { continue; }
+                auto member_done = reds[j]->done(_get(s, j));
+                all = all ? _and(all, member_done) : member_done;
+            }
+            return all;
+        };
+    }
+
+    if (group.iters.empty()) {
+        auto acc = [reds, used](Expr s, Expr v) {
+            vector<Expr> states;
+            for (size_t j = 0; j < reds.size(); j++) {
+                auto state = _get(s, j);
+                states.push_back(used[j] ? reds[j]->acc(state, v) : state);
+            }
+            return _new(states);
+        };
+        return _red(group.vec, init, acc, done);
+    }
+
+    // Scans and conditions shared by every member stay in the predicate of
+    // the fused Op
+    vector<vector<Expr>> conjuncts;
+    for (auto& member : group.members) {
+        conjuncts.push_back({});
+        if (member.used) { flatten_and(member.pred, conjuncts.back()); }
+    }
+    auto shared = [&](Expr conj) {
+        if (is_scan(conj, group.iters)) { return true; }
+        for (size_t j = 0; j < conjuncts.size(); j++) {
+            if (used[j] && find(conjuncts[j].begin(), conjuncts[j].end(),
+                                conj) == conjuncts[j].end()) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    auto leader = find(used.begin(), used.end(), true) - used.begin();
+    Expr pred;
+    for (auto& conj : conjuncts[leader]) {
+        if (shared(conj)) { pred = pred ? _and(pred, conj) : conj; }
+    }
+
+    // Each member contributes the rest of its predicate, if any, then its
+    // outputs
+    vector<Expr> outputs;
+    vector<int> conds;  // output with the condition of a member, or -1
+    vector<size_t> offsets;
+    vector<Expr> any;
+    for (size_t j = 0; j < group.members.size(); j++) {
+        Expr cond;
+        for (auto& conj : conjuncts[j]) {
+            if (!shared(conj)) { cond = cond ? _and(cond, conj) : conj; }
+        }
+
+        if (cond) {
+            auto cond_sym = cond->symify("_fused_pred");
+            tbl[cond_sym] = cond;
+            conds.push_back(outputs.size());
+            outputs.push_back(cond_sym);
+            any.push_back(cond_sym);
+        } else {
+            conds.push_back(-1);
+        }
+
+        offsets.push_back(outputs.size());
+        auto& member_outputs = group.members[j].outputs;
+        outputs.insert(outputs.end(), member_outputs.begin(),
+                       member_outputs.end());
+    }
+    offsets.push_back(outputs.size());
+
+    // Rows no member selects are filtered out by the loop condition
+    if (any.size() == (size_t)count(used.begin(), used.end(), true)) {
+        Expr any_cond = any[0];
+        for (size_t j = 1; j < any.size(); j++) {
+            any_cond = _or(any_cond, any[j]);
+        }
+        auto any_sym = any_cond->symify("_fused_any");
+        tbl[any_sym] = any_cond;
+        pred = _and(pred, any_sym);
+    }
+
+    auto n_iters = group.iters.size();
+    auto acc = [reds, used, conds, offsets, n_iters](Expr s, Expr v) {
+        vector<Expr> states;
+        for (size_t j = 0; j < reds.size(); j++) {
+            auto state = _get(s, j);
+            if (!used[j]) {
+                states.push_back(state);
+                continue;
+            }
+
+            vector<Expr> vals;
+            for (size_t k = 0; k < n_iters; k++) { vals.push_back(_get(v, k)); }
+            for (size_t k = offsets[j]; k < offsets[j + 1]; k++) {
+                vals.push_back(_get(v, n_iters + k));
+            }
+
+            auto new_state = reds[j]->acc(state, _new(vals));
+            if (conds[j] >= 0) {
+                new_state = _sel(_get(v, n_iters + conds[j]), new_state, state);
+            }
+            states.push_back(new_state);
+        }
+        return _new(states);
+    };
+
+    return _red(_op(group.iters, pred, outputs), init, acc, done);
+}
+
+shared_ptr<Func> FusePass::Build(shared_ptr<Func> func)
+{
+    FusePass pass;
+    pass.group(*func);
+    if (pass._groups.empty()) { return func; }
+
+    auto new_func = static_pointer_cast<Func>(pass.eval(func));
+    for (auto& group : pass._groups) {
+        auto used = [](const Member& member) { return member.used; };
+        if (any_of(group.members.begin(), group.members.end(), used)) {
+            new_func->tbl[group.sym] = pass.fuse(group, new_func->tbl);
+        }
+    }
+
+    return new_func;
+}
@@ -10,7 +10,8 @@ shared_ptr<Op> IRClone::visit_op(Op& op)
 {
     vector<Sym> new_iters;
     for (auto& old_iter : op.iters) {
-        auto new_iter = _sym(old_iter->name, old_iter);
+        auto new_iter =
+            this->_reuse_syms ? old_iter : _sym(old_iter->name, old_iter);
         new_iters.push_back(new_iter);
         this->map_sym(old_iter, new_iter);
     }
@@ -27,7 +28,7 @@ shared_ptr<Op> IRClone::visit_op(Op& op)
 
 Expr IRClone::visit(Reduce& red)
 {
-    return _red(eval(red.vec), red.init, red.acc);
+    return _red(eval(red.vec), red.init, red.acc, red.done);
 }
 
 Expr IRClone::visit(Op& op) { return IRClone::visit_op(op); }
@@ -98,7 +99,8 @@ Expr IRClone::visit(Func& func)
 
     // Populate loop function inputs
     for (auto& old_input : func.inputs) {
-        auto new_input = _sym(old_input->name, old_input);
+        auto new_input =
+            this->_reuse_syms ? old_input : _sym(old_input->name, old_input);
         new_func->inputs.push_back(new_input);
         this->map_sym(old_input, new_input);
     }
@@ -108,7 +110,10 @@ Expr IRClone::visit(Func& func)
     return new_func;
 }
 
-Expr IRClone::visit(Sym old_sym) { return _sym(old_sym->name, old_sym); }
+Expr IRClone::visit(Sym old_sym)
+{
+    return this->_reuse_syms ? old_sym : _sym(old_sym->name, old_sym);
+}
 
 Expr IRClone::visit(ThreadIdx&) { return _tidx(); }
 
@@ -124,7 +129,8 @@ Expr IRClone::visit(Define& define)
 {
     if (this->ctx().sym_sym_map.find(define.sym) ==
         this->ctx().sym_sym_map.end()) {
-        auto new_sym = _sym(define.sym->name, define.sym);
+        auto new_sym = this->_reuse_syms ? define.sym
+                                         : _sym(define.sym->name, define.sym);
         this->map_sym(define.sym, new_sym);
         return _define(new_sym, eval(define.val));
     } else {
@@ -0,0 +1,147 @@
+#include "reffine/pass/licmpass.h"
+
+#include "reffine/builder/reffiner.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+static const set<string> PURE_CALLS = {
+    "get_vector_array",
+    "get_array_child",
+    "get_array_buf",
+};
+
+bool LICMPass::is_invariant(Expr expr)
+{
+    if (this->_invariant.contains(expr.get())) {
+        return this->_invariant.at(expr.get());
+    }
+
+    bool res = false;
+    vector<Expr> args;
+    if (dynamic_pointer_cast<Const>(expr)) {
+        res = true;
+    } else if (auto sym = dynamic_pointer_cast<SymNode>(expr)) {
+        if (this->_inputs.contains(sym.get())) {
+            res = true;
+        } else if (this->ctx().in_sym_tbl.contains(sym)) {
+            res = is_invariant(this->ctx().in_sym_tbl.at(sym));
+        }
+    } else if (auto cast = dynamic_pointer_cast<Cast>(expr)) {
+        res = true;
+        args = {cast->arg};
+    } else if (auto get = dynamic_pointer_cast<Get>(expr)) {
+        res = true;
+        args = {get->val};
+    } else if (auto nary = dynamic_pointer_cast<NaryExpr>(expr)) {
+        // Division is left in place as hoisting it could trap
+        res = nary->op != MathOp::DIV && nary->op != MathOp::MOD;
+        args = nary->args;
+    } else if (auto call = dynamic_pointer_cast<Call>(expr)) {
+        res = PURE_CALLS.contains(call->name);
+        args = call->args;
+    } else if (auto fetch = dynamic_pointer_cast<FetchDataPtr>(expr)) {
+        res = true;
+        args = {fetch->vec};
+    }
+
+    for (auto& arg : args) { res = res && is_invariant(arg); }
+
+    this->_invariant[expr.get()] = res;
+    return res;
+}
+
+Expr LICMPass::hoist(ExprNode& expr, function<Expr()> clone)
+{
+    if (this->_hoisting || this->_loop_depth == 0 ||
+        !is_invariant(this->tmp_expr(expr))) {
+        return clone();
+    }
+
+    this->_hoisting = true;
+    auto val = clone();
+    this->_hoisting = false;
+
+    // Symbol definitions are hoisted as a whole when the symbol is visited
+    if (this->_defs.contains(&expr)) { return val; }
+
+    auto sym = val->symify("licm");
+    this->assign(sym, val);
+    this->_hoisted.push_back(sym);
+    return sym;
+}
+
+Expr LICMPass::visit(Sym old_sym)
+{
+    auto new_sym = IRClone::visit(old_sym);
+
+    if (!this->_hoisting && this->_loop_depth > 0 &&
+        this->ctx().in_sym_tbl.contains(old_sym) && is_invariant(old_sym)) {
+        this->_hoisted.push_back(new_sym);
+    }
+
+    return new_sym;
+}
+
+Expr LICMPass::visit(Cast& e)
+{
+    return hoist(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr LICMPass::visit(Get& e)
+{
+    return hoist(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr LICMPass::visit(NaryExpr& e)
+{
+    return hoist(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr LICMPass::visit(Call& e)
+{
+    return hoist(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr LICMPass::visit(FetchDataPtr& e)
+{
+    return hoist(e, [&]() { return IRClone::visit(e); });
+}
+
+Expr LICMPass::visit(Loop& loop)
+{
+    auto outer_hoisted = std::move(this->_hoisted);
+    this->_hoisted.clear();
+
+    this->_loop_depth++;
+    auto new_loop = IRClone::visit(loop);
+    this->_loop_depth--;
+
+    // Invariants of nested loops are hoisted up to the outermost loop
+    if (this->_loop_depth > 0) {
+        outer_hoisted.insert(outer_hoisted.end(), this->_hoisted.begin(),
+                             this->_hoisted.end());
+    } else if (!this->_hoisted.empty()) {
+        auto new_loop_ptr = static_pointer_cast<Loop>(new_loop);
+        if (new_loop_ptr->init) {
+            this->_hoisted.push_back(new_loop_ptr->init);
+        }
+        new_loop_ptr->init = _stmts(this->_hoisted);
+    }
+
+    this->_hoisted = std::move(outer_hoisted);
+    return new_loop;
+}
+
+Expr LICMPass::visit(Func& func)
+{
+    for (auto& input : func.inputs) { this->_inputs.insert(input.get()); }
+    for (auto& [sym, val] : func.tbl) { this->_defs.insert(val.get()); }
+
+    return IRClone::visit(func);
+}
+
+shared_ptr<Func> LICMPass::Build(shared_ptr<Func> func)
+{
+    return static_pointer_cast<Func>(LICMPass().eval(func));
+}
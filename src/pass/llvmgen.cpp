@@ -5,6 +5,7 @@
 #include <cstdio>
 #include <filesystem>
 #include <iostream>
+#include <sstream>
 
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
@@ -338,6 +339,9 @@ Value* LLVMGen::visit(FetchDataPtr& e)
 
 Value* LLVMGen::visit(Call& call)
 {
+    if (call.name == "share_vector_col") {
+        this->_shared_vecs.insert(expr_key(call.args[0]));
+    }
     return llcall(call.name, lltype(call), call.args);
 }
 
@@ -357,7 +361,9 @@ Value* LLVMGen::visit(Load& load)
 {
     auto type = lltype(load.addr->type.deref());
     auto addr = builder()->CreateGEP(type, eval(load.addr), eval(load.offset));
-    return CreateLoad(type, addr);
+    auto inst = CreateLoad(type, addr);
+    annotate(inst, load.addr, load.type);
+    return inst;
 }
 
 Value* LLVMGen::visit(Store& store)
@@ -366,7 +372,9 @@ Value* LLVMGen::visit(Store& store)
     auto addr =
         builder()->CreateGEP(type, eval(store.addr), eval(store.offset));
     auto val = eval(store.val);
-    return CreateStore(val, addr);
+    auto inst = CreateStore(val, addr);
+    annotate(inst, store.addr, store.val->type);
+    return inst;
 }
 
 Value* LLVMGen::visit(AtomicOp& e)
@@ -523,7 +531,8 @@ Value* LLVMGen::visit(Loop& loop)
     eval(loop.body);
 
     // Jump back to loop header
-    builder()->CreateBr(header_bb);
+    auto latch = builder()->CreateBr(header_bb);
+    latch->setMetadata(LLVMContext::MD_loop, loop_hints());
 
     // loop post and exit
     parent_fn->insert(parent_fn->end(), exit_bb);
@@ -585,6 +594,9 @@ Value* LLVMGen::visit(Func& func)
 
     builder()->CreateRetVoid();
 
+    add_alias_scopes();
+    link_vinstr();
+
     return fn;
 }
 
@@ -608,11 +620,7 @@ llvm::StoreInst* LLVMGen::CreateStore(Value* new_val, Value* var_addr)
     // Don't allow storing struct
     ASSERT(!new_val->getType()->isStructTy());
 
-    MDNode* md_node = MDNode::get(llctx(), ArrayRef<Metadata*>());
-    auto store = builder()->CreateStore(new_val, var_addr);
-    store->setMetadata(LLVMContext::MD_noalias, md_node);
-
-    return store;
+    return builder()->CreateStore(new_val, var_addr);
 }
 
 llvm::LoadInst* LLVMGen::CreateLoad(Type* type, Value* addr)
@@ -620,11 +628,188 @@ llvm::LoadInst* LLVMGen::CreateLoad(Type* type, Value* addr)
     // Don't allow loading struct
     ASSERT(!type->isStructTy());
 
-    MDNode* md_node = MDNode::get(llctx(), ArrayRef<Metadata*>());
-    auto var = builder()->CreateLoad(type, addr);
-    var->setMetadata(LLVMContext::MD_noalias, md_node);
+    return builder()->CreateLoad(type, addr);
+}
 
-    return var;
+// Follows symbols and casts to the expression that defines a value
+Expr LLVMGen::resolve(Expr expr)
+{
+    while (true) {
+        if (auto sym = dynamic_pointer_cast<SymNode>(expr)) {
+            if (!this->ctx().in_sym_tbl.contains(sym)) { return expr; }
+            expr = this->ctx().in_sym_tbl.at(sym);
+        } else if (auto cast = dynamic_pointer_cast<Cast>(expr)) {
+            expr = cast->arg;
+        } else {
+            return expr;
+        }
+    }
+}
+
+// The vector that buffer `buf` belongs to, if make_vector made it in this
+// function. Its buffers are fresh allocations, unlike those of inputs and of
+// vectors that share columns.
+Expr LLVMGen::made_vector(Expr buf)
+{
+    Expr vec = nullptr;
+    if (auto fetch = dynamic_pointer_cast<FetchDataPtr>(resolve(buf))) {
+        vec = fetch->vec;
+    } else {
+        // get_array_buf(get_array_child(get_vector_array(vec), col), idx)
+        for (auto* name :
+             {"get_array_buf", "get_array_child", "get_vector_array"}) {
+            auto call = dynamic_pointer_cast<Call>(resolve(buf));
+            if (!call || call->name != name) { return nullptr; }
+            buf = call->args[0];
+        }
+        vec = buf;
+    }
+
+    auto make = dynamic_pointer_cast<Call>(resolve(vec));
+    return make && make->name == "make_vector" ? vec : nullptr;
+}
+
+// Identifies the Arrow buffer that `addr` points into. Returns an empty
+// string for stack memory and pointers of unknown origin.
+string LLVMGen::buffer_key(Expr addr)
+{
+    addr = resolve(addr);
+    auto call = dynamic_pointer_cast<Call>(addr);
+    if ((call && call->name == "get_array_buf") ||
+        dynamic_pointer_cast<FetchDataPtr>(addr)) {
+        return expr_key(addr);
+    }
+
+    return "";
+}
+
+string LLVMGen::expr_key(Expr expr)
+{
+    stringstream ss;
+    if (auto sym = dynamic_pointer_cast<SymNode>(expr)) {
+        auto& tbl = this->ctx().in_sym_tbl;
+        if (tbl.contains(sym) && (dynamic_pointer_cast<SymNode>(tbl.at(sym)) ||
+                                  dynamic_pointer_cast<Cast>(tbl.at(sym)))) {
+            return expr_key(tbl.at(sym));
+        }
+        ss << sym.get();
+    } else if (auto cast = dynamic_pointer_cast<Cast>(expr)) {
+        return expr_key(cast->arg);
+    } else if (auto cnst = dynamic_pointer_cast<Const>(expr)) {
+        ss << (int64_t)cnst->val;
+    } else if (auto fetch = dynamic_pointer_cast<FetchDataPtr>(expr)) {
+        ss << "fetch(" << expr_key(fetch->vec) << "," << fetch->col << ")";
+    } else if (auto call = dynamic_pointer_cast<Call>(expr)) {
+        ss << call->name << "(";
+        for (auto& arg : call->args) { ss << expr_key(arg) << ","; }
+        ss << ")";
+    } else {
+        ss << "?" << expr.get();
+    }
+
+    return ss.str();
+}
+
+void LLVMGen::annotate(Instruction* inst, Expr addr, const DataType& type)
+{
+    auto key = buffer_key(addr);
+    if (key.empty()) { return; }
+
+    this->_buffer_accesses.push_back({inst, key});
+    if (auto vec = made_vector(addr)) {
+        this->_made_buffers[key] = expr_key(vec);
+    }
+    if (type.is_primitive()) {
+        inst->setMetadata(LLVMContext::MD_tbaa, tbaa_tag(type));
+    }
+}
+
+// Every Arrow buffer gets its own alias scope. Only buffers of vectors made
+// in the function, none of whose columns are shared, are known to be distinct
+// from the others: accesses to one of those are marked as not aliasing any
+// other buffer, and accesses to any other buffer as not aliasing them. The
+// rest may be one and the same, as share_vector_col points output columns at
+// input buffers.
+void LLVMGen::add_alias_scopes()
+{
+    if (this->_buffer_accesses.empty()) {
+        this->_shared_vecs.clear();
+        return;
+    }
+
+    MDBuilder mdb(llctx());
+    auto domain = mdb.createAnonymousAliasScopeDomain("reffine.buffers");
+
+    map<string, MDNode*> scopes;
+    for (auto& [inst, key] : this->_buffer_accesses) {
+        if (!scopes.contains(key)) {
+            scopes[key] = mdb.createAnonymousAliasScope(domain, key);
+        }
+    }
+
+    auto distinct = [this](const string& key) {
+        auto it = this->_made_buffers.find(key);
+        return it != this->_made_buffers.end() &&
+               !this->_shared_vecs.contains(it->second);
+    };
+
+    map<string, pair<MDNode*, MDNode*>> scope_mds;
+    for (auto& [key, scope] : scopes) {
+        vector<Metadata*> others;
+        for (auto& [other_key, other_scope] : scopes) {
+            if (other_key != key && (distinct(key) || distinct(other_key))) {
+                others.push_back(other_scope);
+            }
+        }
+        scope_mds[key] = {MDNode::get(llctx(), {scope}),
+                          MDNode::get(llctx(), others)};
+    }
+
+    for (auto& [inst, key] : this->_buffer_accesses) {
+        auto& [alias_scope, noalias] = scope_mds.at(key);
+        inst->setMetadata(LLVMContext::MD_alias_scope, alias_scope);
+        inst->setMetadata(LLVMContext::MD_noalias, noalias);
+    }
+    this->_buffer_accesses.clear();
+    this->_made_buffers.clear();
+    this->_shared_vecs.clear();
+}
+
+// Same hints as the pragma emitted by CEmitter. Clang lowers both
+// vectorize(enable) and interleave(enable) to llvm.loop.vectorize.enable,
+// which also leaves the interleave count to the cost model.
+MDNode* LLVMGen::loop_hints()
+{
+    auto vectorize = MDNode::get(
+        llctx(), {MDString::get(llctx(), "llvm.loop.vectorize.enable"),
+                  ConstantAsMetadata::get(builder()->getTrue())});
+    auto progress = MDNode::get(
+        llctx(), {MDString::get(llctx(), "llvm.loop.mustprogress")});
+
+    auto loop_id = MDNode::getDistinct(llctx(), {nullptr, vectorize, progress});
+    loop_id->replaceOperandWith(0, loop_id);
+    return loop_id;
+}
+
+MDNode* LLVMGen::tbaa_tag(const DataType& type)
+{
+    MDBuilder mdb(llctx());
+    if (!this->_tbaa_root) {
+        this->_tbaa_root = mdb.createTBAARoot("reffine.tbaa");
+    }
+
+    // Keyed by the LLVM type, as e.g. INT64 and IDX share the same buffers
+    string name;
+    raw_string_ostream os(name);
+    lltype(type)->print(os);
+    os.flush();
+
+    if (!this->_tbaa_tags.contains(name)) {
+        auto node = mdb.createTBAAScalarTypeNode(name, this->_tbaa_root);
+        this->_tbaa_tags[name] = mdb.createTBAAStructTagNode(node, node, 0);
+    }
+
+    return this->_tbaa_tags.at(name);
 }
 
 llvm::AllocaInst* LLVMGen::CreateAlloca(llvm::Type* type, llvm::Value* size)
@@ -634,7 +819,7 @@ llvm::AllocaInst* LLVMGen::CreateAlloca(llvm::Type* type, llvm::Value* size)
     return builder()->CreateAlloca(type, 5U, size);
 }
 
-void LLVMGen::register_code(const string& llir)
+unique_ptr<llvm::Module> LLVMGen::parse_ir(const string& llir)
 {
     const auto buffer =
         llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(llir.c_str()));
@@ -646,11 +831,38 @@ void LLVMGen::register_code(const string& llir)
         throw std::runtime_error("Failed to verify module");
     }
 
-    llvm::Linker::linkModules(*llmod(), std::move(mod),
+    return mod;
+}
+
+void LLVMGen::register_code(const string& llir)
+{
+    llvm::Linker::linkModules(*llmod(), parse_ir(llir),
                               llvm::Linker::Flags::OverrideFromSrc);
 }
 
-void LLVMGen::parse(const string& code)
+void LLVMGen::link_vinstr()
+{
+    // Function bodies of the lazily loaded module are only materialized
+    // when the linker pulls them in, i.e. for the helpers this module calls
+    llvm::MemoryBufferRef buffer(
+        llvm::StringRef(reinterpret_cast<char*>(vinstr_bc), vinstr_bc_len),
+        "vinstr");
+    auto mod = llvm::getLazyBitcodeModule(buffer, llctx());
+    if (!mod) {
+        throw std::runtime_error("Failed to load vinstr bitcode: " +
+                                 llvm::toString(mod.takeError()));
+    }
+
+    // llvm.used only exists to force the helpers to be emitted
+    if (auto used = (*mod)->getGlobalVariable("llvm.used")) {
+        used->eraseFromParent();
+    }
+
+    llvm::Linker::linkModules(*llmod(), std::move(*mod),
+                              llvm::Linker::Flags::LinkOnlyNeeded);
+}
+
+string LLVMGen::compile_code(const string& code, ISA isa)
 {
     char in_file[] = "/tmp/reffine-llvmgen-XXXXXX.cpp";
     int fd = mkstemps(in_file, /*suffixlen=*/4);
@@ -670,10 +882,11 @@ void LLVMGen::parse(const string& code)
     // Generate LLVM IR
     std::string command =
         "clang++ -S -O3 -emit-llvm "
-        "-Rpass-missed=loop-vectorize -Rpass-analysis=loop-vectorize"
-        " -I " +
-        string(REFFINE_HEADER_DIR) + " -I " + string(REFFINE_SRC_DIR) + " -o " +
-        string(out_file) + " " + string(in_file);
+        "-Rpass-missed=loop-vectorize -Rpass-analysis=loop-vectorize";
+    for (const auto& flag : isa_flags(isa)) { command += " " + flag; }
+    command += " -I " + string(REFFINE_HEADER_DIR) + " -I " +
+               string(REFFINE_SRC_DIR) + " -o " + string(out_file) + " " +
+               string(in_file);
     if (std::system(command.c_str())) {
         throw runtime_error("Error running the command: " + command);
     }
@@ -687,10 +900,35 @@ void LLVMGen::parse(const string& code)
                      std::istreambuf_iterator<char>());
     llfile.close();
 
-    // Register generated LLVM IR to the module
-    register_code(llir);
-
     // Remove temporary files
     std::remove(in_file);
     std::remove(out_file);
+
+    return llir;
+}
+
+void LLVMGen::parse(const string& code, ISA isa)
+{
+    // Register generated LLVM IR to the module
+    register_code(compile_code(code, isa));
+}
+
+void LLVMGen::parse_multiversion(const string& code, const string& fn_name)
+{
+    for (auto isa : isa_variants()) {
+        auto mod = parse_ir(compile_code(code, isa));
+
+        // Everything except the kernel is made internal so that helpers
+        // compiled for one ISA level are never shared with another variant
+        for (auto& f : *mod) {
+            if (f.isDeclaration()) { continue; }
+            if (f.getName() == fn_name) {
+                f.setName(isa_symbol(fn_name, isa));
+            } else {
+                f.setLinkage(llvm::GlobalValue::InternalLinkage);
+            }
+        }
+
+        llvm::Linker::linkModules(*llmod(), std::move(mod));
+    }
 }
@@ -43,7 +43,11 @@ Expr LoopGen::visit(Element& elem)
 
 shared_ptr<Loop> LoopGen::build_loop(Op& op, shared_ptr<Loop> loop)
 {
-    Reffine rpass(make_unique<ReffineCtx>(this->ctx().in_sym_tbl));
+    if (!this->_solver_pool) {
+        this->_solver_pool = make_shared<ReffineSolverPool>();
+    }
+    Reffine rpass(make_unique<ReffineCtx>(this->ctx().in_sym_tbl),
+                  this->_solver_pool);
     for (auto input : this->ctx().out_func->inputs) {
         if (input->type.is_val()) { rpass.vars().insert(input); }
     }
@@ -110,6 +114,47 @@ shared_ptr<Loop> LoopGen::build_loop(Op& op, shared_ptr<Loop> loop)
     return loop;
 }
 
+// Columns that an Op copies from its input: an Op that scans all of a
+// vector `vec` and outputs vec[t][c] writes row i of `vec` to its row i, so
+// the output column can share the buffer of the input column. Only flat
+// columns hold a row per index in their data buffer. Maps output columns to
+// columns of `vec`.
+static map<size_t, size_t> pass_through(Op& op, const SymTable& tbl, Expr& vec)
+{
+    map<size_t, size_t> cols;
+    auto in = dynamic_pointer_cast<In>(op.pred);
+    auto flat = [&in](size_t col) {
+        return in->vec->type.encodings[col] == EncodeType::FLAT;
+    };
+    if (op.iters.size() != 1 || !in || in->iter != op.iters[0] ||
+        in->vec->type.dim != 1 || !flat(0)) {
+        return cols;
+    }
+    vec = in->vec;
+
+    auto def = [&tbl](Expr e) {
+        for (auto sym = dynamic_pointer_cast<SymNode>(e);
+             sym && tbl.contains(sym); sym = dynamic_pointer_cast<SymNode>(e)) {
+            e = tbl.at(sym);
+        }
+        return e;
+    };
+
+    cols[0] = 0;
+    for (size_t i = 0; i < op.outputs.size(); i++) {
+        auto get = dynamic_pointer_cast<Get>(def(op.outputs[i]));
+        if (!get) { continue; }
+        auto elem = dynamic_pointer_cast<Element>(def(get->val));
+        auto col = vec->type.dim + get->col;
+        if (elem && elem->vec == vec && elem->iter == op.iters[0] &&
+            flat(col)) {
+            cols[op.iters.size() + i] = col;
+        }
+    }
+
+    return cols;
+}
+
 Expr LoopGen::visit(Op& op)
 {
     auto len = _idx(100000000);
@@ -160,9 +205,13 @@ Expr LoopGen::visit(Op& op)
     auto bytemap_sym = bytemap->symify("_bytemap");
     this->assign(bytemap_sym, bytemap);
 
-    // Write the output to the out_vec
+    // Write the output to the out_vec, except for columns that are passed
+    // through from the input
+    Expr in_vec;
+    auto shared_cols = pass_through(op, this->ctx().in_sym_tbl, in_vec);
     vector<Expr> body_stmts;
     for (size_t i = 0; i < op.iters.size() + op.outputs.size(); i++) {
+        if (shared_cols.contains(i)) { continue; }
         body_stmts.push_back(_writedata(out_vec_sym, _load(out_vec_idx_addr), i,
                                         _get(loop->output, i)));
     }
@@ -190,12 +239,22 @@ Expr LoopGen::visit(Op& op)
         loop->body_cond = nullptr;
     }
 
+    // Rows written are charged to the buffer pool every 2^16 rows, so that
+    // an output past the memory budget is spilled while it is being written
     loop->body = _stmts(vector<Expr>{
         loop->body,
         _store(out_vec_idx_addr, _add(_load(out_vec_idx_addr), _idx(1))),
+        _ifelse(_eq(_mod(_load(out_vec_idx_addr), _idx(1 << 16)), _idx(0)),
+                _commit(out_vec_sym, _load(out_vec_idx_addr)), _noop()),
     });
-    loop->post = _finalize(out_vec_sym, bytemap_sym, _load(out_vec_idx_addr),
-                           _load(null_count_addr));
+    vector<Expr> post_stmts{_finalize(out_vec_sym, bytemap_sym,
+                                      _load(out_vec_idx_addr),
+                                      _load(null_count_addr))};
+    for (auto& [col, in_col] : shared_cols) {
+        post_stmts.push_back(_sharecol(out_vec_sym, col, eval(in_vec), in_col));
+    }
+    post_stmts.push_back(_commit(out_vec_sym, _load(out_vec_idx_addr)));
+    loop->post = _stmts(post_stmts);
     loop->output = out_vec_sym;
     auto loop_sym = loop->symify("_loop");
     this->assign(loop_sym, loop);
@@ -250,6 +309,14 @@ Expr LoopGen::visit(Reduce& red)
         _store(state_addr, eval(red.init())),
     });
 
+    // Stop as soon as no further row can change the state. Not in vectorized
+    // loops, where a data-dependent exit would keep the loop from being
+    // vectorized.
+    if (red.done && !this->_vectorize) {
+        loop->exit_cond =
+            _or(loop->exit_cond, eval(red.done(_load(state_addr))));
+    }
+
     if (this->_vectorize) {
         loop->body = _stmts(vector<Expr>{_store(
             state_addr, _sel(loop->body_cond,
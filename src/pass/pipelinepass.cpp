@@ -0,0 +1,182 @@
+#include "reffine/pass/pipelinepass.h"
+
+#include "reffine/builder/reffiner.h"
+#include "reffine/pass/base/irpass.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+static void flatten_and(Expr e, vector<Expr>& conjuncts)
+{
+    auto nary = dynamic_pointer_cast<NaryExpr>(e);
+    if (nary && nary->op == MathOp::AND) {
+        for (auto& arg : nary->args) { flatten_and(arg, conjuncts); }
+    } else {
+        conjuncts.push_back(e);
+    }
+}
+
+// The producer an In conjunct of an Op predicate scans, if any
+static Sym scanned(Expr conj, const vector<Sym>& iters)
+{
+    auto in = dynamic_pointer_cast<In>(conj);
+    if (!in || find(iters.begin(), iters.end(), in->iter) == iters.end()) {
+        return nullptr;
+    }
+    return dynamic_pointer_cast<SymNode>(in->vec);
+}
+
+// Finds the Ops that are only read in iterator order: scanned by one Op and
+// otherwise only read at the scanning iterator, or reduced once
+class PipelineAnalysis : public IRPass {
+public:
+    static set<Sym> Build(shared_ptr<Func> func)
+    {
+        PipelineAnalysis pass(func->tbl);
+        func->Accept(pass);
+
+        set<Sym> producers;
+        for (auto& [sym, def] : func->tbl) {
+            auto op = dynamic_pointer_cast<Op>(def);
+            if (!op || op->iters.size() != 1) { continue; }
+
+            auto refs = pass._refs[sym];
+            auto& scans = pass._scans[sym];
+            auto& elems = pass._elems[sym];
+            auto at_scan = [&scans](Expr iter) { return iter == scans[0]; };
+
+            if (scans.size() == 1 && refs == 1 + elems.size() &&
+                all_of(elems.begin(), elems.end(), at_scan)) {
+                producers.insert(sym);
+            } else if (pass._reds[sym] == 1 && refs == 1) {
+                producers.insert(sym);
+            }
+        }
+        return producers;
+    }
+
+private:
+    explicit PipelineAnalysis(const SymTable& tbl)
+        : IRPass(make_unique<IRPassCtx>(tbl))
+    {
+    }
+
+    void Visit(SymNode& symbol) final
+    {
+        this->_refs[this->tmp_sym(symbol)]++;
+        IRPass::Visit(symbol);
+    }
+
+    void Visit(Op& op) final
+    {
+        vector<Expr> conjuncts;
+        flatten_and(op.pred, conjuncts);
+        for (auto& conj : conjuncts) {
+            if (auto vec = scanned(conj, op.iters)) {
+                auto iter = static_pointer_cast<In>(conj)->iter;
+                this->_scans[vec].push_back(iter);
+            }
+        }
+        IRPass::Visit(op);
+    }
+
+    void Visit(Element& elem) final
+    {
+        if (auto vec = dynamic_pointer_cast<SymNode>(elem.vec)) {
+            this->_elems[vec].push_back(elem.iter);
+        }
+        IRPass::Visit(elem);
+    }
+
+    void Visit(Reduce& red) final
+    {
+        if (auto vec = dynamic_pointer_cast<SymNode>(red.vec)) {
+            this->_reds[vec]++;
+        }
+        IRPass::Visit(red);
+    }
+
+    map<Sym, size_t> _refs;
+    map<Sym, vector<Expr>> _scans;
+    map<Sym, vector<Expr>> _elems;
+    map<Sym, size_t> _reds;
+};
+
+Expr PipelinePass::eval_pred(Expr pred, const vector<Sym>& iters)
+{
+    vector<Expr> conjuncts;
+    flatten_and(pred, conjuncts);
+
+    // Scans of producers go first, so that the other conjuncts already read
+    // the producers where they are computed
+    vector<Expr> new_conjuncts(conjuncts.size());
+    for (size_t i = 0; i < conjuncts.size(); i++) {
+        auto vec = scanned(conjuncts[i], iters);
+        if (!vec || !this->_producers.contains(vec)) { continue; }
+
+        // The consumer iterates where the producer does, which may itself
+        // scan another producer
+        auto iter = static_pointer_cast<In>(conjuncts[i])->iter;
+        auto& producer = static_cast<Op&>(*this->ctx().in_sym_tbl.at(vec));
+        this->map_sym(producer.iters[0],
+                      static_pointer_cast<SymNode>(eval(iter)));
+        this->_scan_iters[vec] = iter;
+        new_conjuncts[i] = eval_pred(producer.pred, producer.iters);
+    }
+
+    Expr new_pred;
+    for (size_t i = 0; i < conjuncts.size(); i++) {
+        if (!new_conjuncts[i]) { new_conjuncts[i] = eval(conjuncts[i]); }
+        new_pred = new_pred ? _and(new_pred, new_conjuncts[i])
+                            : new_conjuncts[i];
+    }
+
+    return new_pred;
+}
+
+Expr PipelinePass::visit(Op& op)
+{
+    for (auto& iter : op.iters) { this->map_sym(iter, iter); }
+
+    auto new_pred = eval_pred(op.pred, op.iters);
+
+    vector<Expr> new_outputs;
+    for (auto& output : op.outputs) { new_outputs.push_back(eval(output)); }
+
+    return _op(op.iters, new_pred, new_outputs);
+}
+
+Expr PipelinePass::visit(Element& elem)
+{
+    auto vec = dynamic_pointer_cast<SymNode>(elem.vec);
+    if (vec && this->_scan_iters.contains(vec) &&
+        this->_scan_iters.at(vec) == elem.iter) {
+        // Read the row of the producer where it is computed
+        auto& producer = static_cast<Op&>(*this->ctx().in_sym_tbl.at(vec));
+        vector<Expr> vals;
+        for (auto& output : producer.outputs) { vals.push_back(eval(output)); }
+        return _new(vals);
+    }
+
+    return IRClone::visit(elem);
+}
+
+Expr PipelinePass::visit(Reduce& red)
+{
+    auto vec = dynamic_pointer_cast<SymNode>(red.vec);
+    if (vec && this->_producers.contains(vec)) {
+        auto& producer = this->ctx().in_sym_tbl.at(vec);
+        return _red(eval(producer), red.init, red.acc, red.done);
+    }
+
+    return IRClone::visit(red);
+}
+
+shared_ptr<Func> PipelinePass::Build(shared_ptr<Func> func)
+{
+    auto producers = PipelineAnalysis::Build(func);
+    if (producers.empty()) { return func; }
+
+    PipelinePass pass(producers);
+    return static_pointer_cast<Func>(pass.eval(func));
+}
@@ -0,0 +1,236 @@
+#include "reffine/pass/projectpass.h"
+
+#include "reffine/builder/reffiner.h"
+#include "reffine/pass/base/irpass.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+// The input vector a vector expression reads, if any
+static Sym input_vec(Expr vec, const SymTable& tbl)
+{
+    while (true) {
+        if (auto subvec = dynamic_pointer_cast<SubVector>(vec)) {
+            vec = subvec->vec;
+        } else if (auto sym = dynamic_pointer_cast<SymNode>(vec)) {
+            if (!tbl.contains(sym)) { return sym; }
+            vec = tbl.at(sym);
+        } else {
+            return nullptr;
+        }
+    }
+}
+
+// Columns that a share_vector_col call (see ShareColumn) passes through from
+// its source vector, args[2], to its output vector, args[0]
+static bool is_share(const Call& call)
+{
+    return call.name == "share_vector_col";
+}
+
+static size_t share_col(const Call& call, size_t arg)
+{
+    return static_pointer_cast<Const>(call.args[arg])->val;
+}
+
+class ColumnAnalysis : public IRPass {
+public:
+    static map<Sym, ColumnSet> Build(shared_ptr<Func> func)
+    {
+        ColumnAnalysis pass(func->tbl);
+        func->Accept(pass);
+
+        map<Sym, ColumnSet> cols;
+        for (auto& input : func->inputs) {
+            if (!input->type.is_vector()) { continue; }
+
+            // Iterator columns locate the rows of the other columns
+            auto& input_cols = cols[input];
+            for (size_t col = 0; col < input->type.dim; col++) {
+                input_cols.insert(col);
+            }
+            input_cols.insert(pass._cols[input].begin(),
+                              pass._cols[input].end());
+        }
+        return cols;
+    }
+
+private:
+    explicit ColumnAnalysis(const SymTable& tbl)
+        : IRPass(make_unique<IRPassCtx>(tbl))
+    {
+    }
+
+    void read(Expr vec, size_t col)
+    {
+        if (auto input = input_vec(vec, this->ctx().in_sym_tbl)) {
+            this->_cols[input].insert(col);
+        }
+    }
+
+    void Visit(ReadRunEnd& expr) final
+    {
+        read(expr.vec, expr.col);
+        IRPass::Visit(expr);
+    }
+
+    void Visit(ReadData& expr) final
+    {
+        read(expr.vec, expr.col);
+        IRPass::Visit(expr);
+    }
+
+    void Visit(ReadBit& expr) final
+    {
+        read(expr.vec, expr.col);
+        IRPass::Visit(expr);
+    }
+
+    void Visit(Length& expr) final
+    {
+        read(expr.vec, expr.col);
+        IRPass::Visit(expr);
+    }
+
+    void Visit(FetchDataPtr& expr) final
+    {
+        read(expr.vec, expr.col);
+        IRPass::Visit(expr);
+    }
+
+    void Visit(Call& call) final
+    {
+        if (is_share(call)) { read(call.args[2], share_col(call, 3)); }
+        IRPass::Visit(call);
+    }
+
+    map<Sym, ColumnSet> _cols;
+};
+
+size_t ProjectPass::project(Expr vec, size_t col)
+{
+    auto input = input_vec(vec, this->ctx().out_sym_tbl);
+    if (!input || !this->_projections.contains(input)) { return col; }
+
+    auto& cols = this->_projections.at(input);
+    auto it = lower_bound(cols.begin(), cols.end(), col);
+    if (it == cols.end() || *it != col) {
+        throw runtime_error("Column " + to_string(col) + " of " +
+                            input->name + " is not projected");
+    }
+    return it - cols.begin();
+}
+
+Expr ProjectPass::visit(Sym old_sym)
+{
+    // Subvectors of a projected input have the projected columns
+    auto subvec =
+        dynamic_pointer_cast<SubVector>(this->ctx().in_sym_tbl.at(old_sym));
+    if (subvec) {
+        return _sym(old_sym->name, eval(subvec->vec)->type.valty());
+    }
+    return IRClone::visit(old_sym);
+}
+
+Expr ProjectPass::visit(ReadRunEnd& expr)
+{
+    auto vec = eval(expr.vec);
+    auto idx = eval(expr.idx);
+
+    return _readrunend(vec, idx, project(vec, expr.col));
+}
+
+Expr ProjectPass::visit(ReadData& expr)
+{
+    auto vec = eval(expr.vec);
+    auto idx = eval(expr.idx);
+
+    return _readdata(vec, idx, project(vec, expr.col));
+}
+
+Expr ProjectPass::visit(ReadBit& expr)
+{
+    auto vec = eval(expr.vec);
+    auto idx = eval(expr.idx);
+
+    return _readbit(vec, idx, project(vec, expr.col));
+}
+
+Expr ProjectPass::visit(Length& expr)
+{
+    auto vec = eval(expr.vec);
+    return _len(vec, project(vec, expr.col));
+}
+
+Expr ProjectPass::visit(FetchDataPtr& expr)
+{
+    auto vec = eval(expr.vec);
+    return _fetch(vec, project(vec, expr.col));
+}
+
+Expr ProjectPass::visit(Call& call)
+{
+    if (!is_share(call)) { return IRClone::visit(call); }
+
+    auto src = eval(call.args[2]);
+    return _sharecol(eval(call.args[0]), share_col(call, 1), src,
+                     project(src, share_col(call, 3)));
+}
+
+Expr ProjectPass::visit(Func& func)
+{
+    auto new_func = _func(func.name, nullptr, vector<Sym>{});
+    auto new_ctx = make_unique<IRGenCtx>(func, new_func);
+    this->switch_ctx(new_ctx);
+
+    for (auto& old_input : func.inputs) {
+        if (!this->_cols.contains(old_input)) {
+            auto new_input = _sym(old_input->name, old_input);
+            new_func->inputs.push_back(new_input);
+            this->map_sym(old_input, new_input);
+            continue;
+        }
+
+        auto& type = old_input->type;
+        vector<size_t> cols(this->_cols.at(old_input).begin(),
+                            this->_cols.at(old_input).end());
+        vector<DataType> dtypes;
+        vector<EncodeType> encodings;
+        for (auto col : cols) {
+            dtypes.push_back(type.dtypes[col]);
+            encodings.push_back(type.encodings[col]);
+        }
+
+        auto new_input = _sym(
+            old_input->name,
+            DataType(BaseType::VECTOR, dtypes, type.dim, encodings));
+        new_func->inputs.push_back(new_input);
+        this->map_sym(old_input, new_input);
+        this->_projections[new_input] = cols;
+    }
+
+    new_func->output = eval(func.output);
+
+    return new_func;
+}
+
+map<Sym, ColumnSet> ProjectPass::Columns(shared_ptr<Func> func)
+{
+    return ColumnAnalysis::Build(func);
+}
+
+shared_ptr<Func> ProjectPass::Build(shared_ptr<Func> func,
+                                    const map<Sym, ColumnSet>& cols)
+{
+    for (auto& [input, input_cols] : cols) {
+        for (size_t col = 0; col < input->type.dim; col++) {
+            if (!input_cols.contains(col)) {
+                throw runtime_error("Iterator columns of " + input->name +
+                                    " must be projected");
+            }
+        }
+    }
+
+    ProjectPass pass(cols);
+    return static_pointer_cast<Func>(pass.eval(func));
+}
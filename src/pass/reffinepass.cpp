@@ -1,14 +1,111 @@
 #include "reffine/pass/reffinepass.h"
 
+#include <sstream>
+
 #include "reffine/builder/reffiner.h"
+#include "reffine/pass/base/irpass.h"
 #include "reffine/pass/z3solver.h"
 
 using namespace reffine;
 using namespace reffine::reffiner;
 
-ISpace Reffine::extract_bound(NaryExpr& e)
+bool Reffine::is_affine(Expr e)
+{
+    // Strict bounds are tightened by one, so only integers are affine here
+    if (!e->type.is_int() && !e->type.is_idx()) { return false; }
+
+    if (dynamic_pointer_cast<Const>(e)) {
+        return true;
+    } else if (auto sym = dynamic_pointer_cast<SymNode>(e)) {
+        return this->vars().contains(sym);
+    } else if (auto nary = dynamic_pointer_cast<NaryExpr>(e)) {
+        switch (nary->op) {
+            case MathOp::ADD:
+            case MathOp::SUB:
+                return is_affine(nary->arg(0)) && is_affine(nary->arg(1));
+            case MathOp::NEG:
+                return is_affine(nary->arg(0));
+            case MathOp::MUL:
+                return (dynamic_pointer_cast<Const>(nary->arg(0)) &&
+                        is_affine(nary->arg(1))) ||
+                       (dynamic_pointer_cast<Const>(nary->arg(1)) &&
+                        is_affine(nary->arg(0)));
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+optional<IterBound> Reffine::affine_bound(NaryExpr& e)
+{
+    // Strict bounds are tightened by one, which only holds for integers. The
+    // bound itself is checked by is_affine().
+    auto iter_type = this->iter()->type;
+    if (!iter_type.is_int() && !iter_type.is_idx()) { return nullopt; }
+
+    // Normalize to `iter op val`
+    auto op = e.op;
+    Expr val;
+    if (e.arg(0) == this->iter() && is_affine(e.arg(1))) {
+        val = e.arg(1);
+    } else if (e.arg(1) == this->iter() && is_affine(e.arg(0))) {
+        val = e.arg(0);
+        switch (op) {
+            case MathOp::LT:
+                op = MathOp::GT;
+                break;
+            case MathOp::LTE:
+                op = MathOp::GTE;
+                break;
+            case MathOp::GT:
+                op = MathOp::LT;
+                break;
+            case MathOp::GTE:
+                op = MathOp::LTE;
+                break;
+            default:
+                return nullopt;
+        }
+    } else {
+        return nullopt;
+    }
+
+    auto shift = [&](int64_t delta) -> Expr {
+        if (auto cnst = dynamic_pointer_cast<Const>(val)) {
+            return _const(iter_type, cnst->val + delta);
+        }
+        return _add(val, _const(val->type, delta));
+    };
+
+    switch (op) {
+        case MathOp::GTE:
+            return IterBound{true, val};
+        case MathOp::GT:
+            return IterBound{true, shift(1)};
+        case MathOp::LTE:
+            return IterBound{false, val};
+        case MathOp::LT:
+            return IterBound{false, shift(-1)};
+        default:
+            return nullopt;
+    }
+}
+
+optional<IterBound> Reffine::solve_bound(NaryExpr& e)
 {
     auto pred = this->tmp_expr(e);
+
+    // Solved bounds only refer to the iterator and the variables, so those
+    // (by identity) together with the predicate determine the result
+    stringstream key;
+    key << pred->str() << "|" << this->iter().get();
+    for (auto var : this->vars()) { key << "|" << var.get(); }
+    if (this->_pool->bounds.contains(key.str())) {
+        return this->_pool->bounds.at(key.str());
+    }
+
     auto bias = _sym("b_" + this->iter()->name, this->iter());
     Expr bound = bias;
 
@@ -27,10 +124,14 @@ ISpace Reffine::extract_bound(NaryExpr& e)
     auto lb_prop = _forall(vars, _eq(_gte(this->iter(), bound), pred));
     auto ub_prop = _forall(vars, _eq(_lte(this->iter(), bound), pred));
 
-    Z3Solver lb_solver, ub_solver;
+    if (!this->_pool->z3ctx) {
+        this->_pool->z3ctx = make_shared<z3::context>();
+    }
+    Z3Solver lb_solver(this->_pool->z3ctx), ub_solver(this->_pool->z3ctx);
     auto lb_check = lb_solver.check(lb_prop);
-    auto ub_check = ub_solver.check(ub_prop);
+    auto ub_check = !lb_check && ub_solver.check(ub_prop);
 
+    optional<IterBound> res;
     if (lb_check || ub_check) {
         auto& solver = lb_check ? lb_solver : ub_solver;
         Expr bound_val = solver.get(bias);
@@ -40,9 +141,22 @@ ISpace Reffine::extract_bound(NaryExpr& e)
                 bound_val = _add(bound_val, _mul(weight, v));
             }
         }
+        res = IterBound{lb_check, bound_val};
+    }
+
+    this->_pool->bounds[key.str()] = res;
+    return res;
+}
+
+ISpace Reffine::extract_bound(NaryExpr& e)
+{
+    auto bound = affine_bound(e);
+    if (!bound) { bound = solve_bound(e); }
+
+    if (bound) {
         auto iter_ispace = eval(this->iter());
-        auto const_ispace = make_shared<ConstantSpace>(bound_val);
-        if (lb_check) {
+        auto const_ispace = make_shared<ConstantSpace>(bound->val);
+        if (bound->is_lower) {
             return make_shared<LBoundSpace>(iter_ispace, const_ispace);
         } else {
             return make_shared<UBoundSpace>(iter_ispace, const_ispace);
@@ -121,3 +235,130 @@ ISpace Reffine::visit(Op& op)
         return ispace;
     }
 }
+
+static void flatten_and(Expr e, vector<Expr>& conjuncts)
+{
+    auto nary = dynamic_pointer_cast<NaryExpr>(e);
+    if (nary && nary->op == MathOp::AND) {
+        for (auto& arg : nary->args) { flatten_and(arg, conjuncts); }
+    } else {
+        conjuncts.push_back(e);
+    }
+}
+
+// Ops that scan a vector with their first iterator, and whether the vector
+// is used in any other way
+class ScanAnalysis : public IRPass {
+public:
+    ScanAnalysis(const SymTable& tbl, Sym vec)
+        : IRPass(make_unique<IRPassCtx>(tbl)), _vec(vec)
+    {
+    }
+
+    vector<Expr> scans;
+    bool other_uses = false;
+
+private:
+    void Visit(SymNode& symbol) final
+    {
+        if (this->tmp_sym(symbol) == this->_vec) { this->_refs++; }
+        IRPass::Visit(symbol);
+    }
+
+    void Visit(Op& op) final
+    {
+        vector<Expr> conjuncts;
+        flatten_and(op.pred, conjuncts);
+
+        size_t n_scans = 0;
+        for (auto& conj : conjuncts) {
+            auto in = dynamic_pointer_cast<In>(conj);
+            if (in && in->vec == this->_vec && in->iter == op.iters[0]) {
+                n_scans++;
+            }
+        }
+        if (n_scans > 0) {
+            this->scans.push_back(this->tmp_expr(op));
+            this->_scan_iters.insert(op.iters[0]);
+        }
+
+        IRPass::Visit(op);
+        this->_refs -= n_scans;
+    }
+
+    void Visit(Element& elem) final
+    {
+        IRPass::Visit(elem);
+        auto iter = dynamic_pointer_cast<SymNode>(elem.iter);
+        if (elem.vec == this->_vec && this->_scan_iters.contains(iter)) {
+            this->_refs--;
+        }
+    }
+
+    void Visit(Func& func) final
+    {
+        IRPass::Visit(func);
+        this->other_uses = (this->_refs > 0);
+    }
+
+    Sym _vec;
+    size_t _refs = 0;
+    set<Sym> _scan_iters;
+};
+
+static IterRange iter_range(ISpace ispace)
+{
+    auto const_val = [](ISpace bound) {
+        auto cnst = dynamic_pointer_cast<Const>(bound->iter);
+        return cnst ? optional<double>(cnst->val) : nullopt;
+    };
+
+    if (auto lbound = dynamic_pointer_cast<LBoundSpace>(ispace)) {
+        auto range = iter_range(lbound->ispace);
+        if (auto lo = const_val(lbound->bound)) {
+            range.lo = max(range.lo, *lo);
+        }
+        return range;
+    } else if (auto ubound = dynamic_pointer_cast<UBoundSpace>(ispace)) {
+        auto range = iter_range(ubound->ispace);
+        if (auto hi = const_val(ubound->bound)) {
+            range.hi = min(range.hi, *hi);
+        }
+        return range;
+    } else if (auto filtered = dynamic_pointer_cast<FilteredSpace>(ispace)) {
+        return iter_range(filtered->ispace);
+    } else if (auto inter = dynamic_pointer_cast<InterSpace>(ispace)) {
+        auto left = iter_range(inter->left);
+        auto right = iter_range(inter->right);
+        return IterRange{max(left.lo, right.lo), min(left.hi, right.hi)};
+    } else if (auto uni = dynamic_pointer_cast<UnionSpace>(ispace)) {
+        auto left = iter_range(uni->left);
+        auto right = iter_range(uni->right);
+        return IterRange{min(left.lo, right.lo), max(left.hi, right.hi)};
+    } else if (auto nested = dynamic_pointer_cast<NestedSpace>(ispace)) {
+        return iter_range(nested->outer);
+    } else {
+        return IterRange{};
+    }
+}
+
+IterRange Reffine::ScanRange(shared_ptr<Func> func, Sym vec)
+{
+    ScanAnalysis analysis(func->tbl, vec);
+    func->Accept(analysis);
+    if (analysis.scans.empty() || analysis.other_uses) { return IterRange{}; }
+
+    auto pool = make_shared<ReffineSolverPool>();
+    IterRange range{INFINITY, -INFINITY};
+    for (auto& scan : analysis.scans) {
+        Reffine rpass(make_unique<ReffineCtx>(func->tbl), pool);
+        for (auto input : func->inputs) {
+            if (input->type.is_val()) { rpass.vars().insert(input); }
+        }
+
+        auto scan_range = iter_range(rpass.eval(scan));
+        range.lo = min(range.lo, scan_range.lo);
+        range.hi = max(range.hi, scan_range.hi);
+    }
+    return range;
+}
@@ -0,0 +1,50 @@
+#include "reffine/pass/specializepass.h"
+
+#include "reffine/builder/reffiner.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+Expr SpecializePass::visit(Func& func)
+{
+    auto new_func = _func(func.name, nullptr, vector<Sym>{});
+    auto new_ctx = make_unique<IRGenCtx>(func, new_func);
+    this->switch_ctx(new_ctx);
+
+    for (auto& old_input : func.inputs) {
+        if (this->_params.contains(old_input)) {
+            // The bound input becomes a constant, and an unused symbol keeps
+            // its place in the signature
+            auto val = this->_params.at(old_input);
+            ASSERT(val->type == old_input->type);
+            new_func->inputs.push_back(
+                _sym(old_input->name + "_unused", old_input));
+            this->assign(old_input, val);
+        } else {
+            new_func->inputs.push_back(old_input);
+        }
+        this->map_sym(old_input, old_input);
+    }
+
+    new_func->output = eval(func.output);
+
+    return new_func;
+}
+
+shared_ptr<Func> SpecializePass::Build(shared_ptr<Func> func,
+                                       const map<Sym, Expr>& params,
+                                       string name)
+{
+    for (auto& [param, val] : params) {
+        if (find(func->inputs.begin(), func->inputs.end(), param) ==
+            func->inputs.end()) {
+            throw runtime_error("Not an input of " + func->name + ": " +
+                                param->name);
+        }
+    }
+
+    auto new_func =
+        static_pointer_cast<Func>(SpecializePass(params).eval(func));
+    new_func->name = name;
+    return new_func;
+}
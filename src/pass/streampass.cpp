@@ -0,0 +1,111 @@
+#include "reffine/pass/streampass.h"
+
+#include "reffine/builder/reffiner.h"
+#include "reffine/pass/base/irpass.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+// The symbol a function returns and the reduction it stands for
+static pair<Sym, shared_ptr<Reduce>> output_red(shared_ptr<Func> func)
+{
+    auto output = dynamic_pointer_cast<SymNode>(func->output);
+    auto red = output && func->tbl.contains(output)
+                   ? dynamic_pointer_cast<Reduce>(func->tbl.at(output))
+                   : nullptr;
+    if (!red || !red->type.is_primitive()) {
+        throw runtime_error("Only functions returning a primitive reduction "
+                            "can be streamed: " +
+                            func->name);
+    }
+    return make_pair(output, red);
+}
+
+// Finds calls to vector_locate
+class LocateAnalysis : public IRPass {
+public:
+    explicit LocateAnalysis(const SymTable& tbl)
+        : IRPass(make_unique<IRPassCtx>(tbl))
+    {
+    }
+
+    bool locates = false;
+
+private:
+    void Visit(Call& call) final
+    {
+        if (call.name == "vector_locate") { this->locates = true; }
+        IRPass::Visit(call);
+    }
+};
+
+Expr StreamPass::visit(Reduce& red)
+{
+    if (&red != this->_output_red) { return IRClone::visit(red); }
+
+    // Only the first batch starts from the initial state
+    auto init = [init = red.init, state = this->_state,
+                 first = this->_first]() { return _sel(first, init(), state); };
+    return _red(eval(red.vec), init, red.acc, red.done);
+}
+
+Expr StreamPass::visit(Func& func)
+{
+    auto new_func = _func(func.name, nullptr, vector<Sym>{});
+    auto new_ctx = make_unique<IRGenCtx>(func, new_func);
+    this->switch_ctx(new_ctx);
+
+    for (auto& input : func.inputs) {
+        new_func->inputs.push_back(input);
+        this->map_sym(input, input);
+    }
+    new_func->inputs.push_back(this->_state);
+    new_func->inputs.push_back(this->_first);
+
+    new_func->output = eval(func.output);
+
+    return new_func;
+}
+
+shared_ptr<Func> StreamPass::Build(shared_ptr<Func> func)
+{
+    auto [output, red] = output_red(func);
+    auto state = _sym(output->name + "_state", red->type);
+    auto first = _sym(output->name + "_first", types::BOOL);
+    StreamPass pass(red.get(), state, first);
+    return static_pointer_cast<Func>(pass.eval(func));
+}
+
+shared_ptr<Func> StreamPass::Init(shared_ptr<Func> func)
+{
+    auto [output, red] = output_red(func);
+    auto init = red->init();
+    auto init_sym = _sym(output->name + "_init", init);
+    shared_ptr<Func> init_fn =
+        _func(func->name + "_init", init_sym, vector<Sym>{});
+    init_fn->tbl[init_sym] = init;
+
+    return init_fn;
+}
+
+shared_ptr<Func> StreamPass::Done(shared_ptr<Func> func)
+{
+    auto [output, red] = output_red(func);
+    if (!red->done) { return nullptr; }
+
+    auto state = _sym(output->name + "_state", red->type);
+    auto done = red->done(state);
+    auto done_sym = _sym(output->name + "_done", done);
+    shared_ptr<Func> done_fn =
+        _func(func->name + "_done", done_sym, vector<Sym>{state});
+    done_fn->tbl[done_sym] = done;
+
+    return done_fn;
+}
+
+bool StreamPass::Locates(shared_ptr<Func> loop)
+{
+    LocateAnalysis pass(loop->tbl);
+    loop->Accept(pass);
+    return pass.locates;
+}
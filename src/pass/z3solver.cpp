@@ -5,11 +5,20 @@
 using namespace reffine;
 using namespace reffine::reffiner;
 
+string Z3Solver::sym_name(SymNode& s)
+{
+    if (!this->_names.contains(&s)) {
+        this->_names[&s] = s.name + "#" + to_string(this->_names.size());
+    }
+    return this->_names.at(&s);
+}
+
 void Z3Solver::Visit(SymNode& s)
 {
+    auto name = sym_name(s);
     switch (s.type.btype) {
         case BaseType::BOOL:
-            assign(ctx().bool_const(s.name.c_str()));
+            assign(ctx().bool_const(name.c_str()));
             break;
         case BaseType::INT8:
         case BaseType::INT16:
@@ -20,11 +29,11 @@ void Z3Solver::Visit(SymNode& s)
         case BaseType::UINT32:
         case BaseType::UINT64:
         case BaseType::IDX:
-            assign(ctx().int_const(s.name.c_str()));
+            assign(ctx().int_const(name.c_str()));
             break;
         case BaseType::FLOAT32:
         case BaseType::FLOAT64:
-            assign(ctx().real_const(s.name.c_str()));
+            assign(ctx().real_const(name.c_str()));
             break;
         default:
             throw std::runtime_error("Invalid constant type");
@@ -153,6 +162,19 @@ bool Z3Solver::check(Expr conj)
     return s().check() == z3::sat;
 }
 
+bool Z3Solver::refute(Expr conj)
+{
+    s().add(eval(conj));
+    return s().check() == z3::unsat;
+}
+
+void Z3Solver::set_timeout(unsigned ms)
+{
+    z3::params params(ctx());
+    params.set("timeout", ms);
+    s().set(params);
+}
+
 shared_ptr<Const> Z3Solver::get(Expr val)
 {
     auto z3val = s().get_model().eval(eval(val));
@@ -7,28 +7,734 @@
 #include <arrow/ipc/api.h>
 #include <arrow/result.h>
 #include <arrow/status.h>
+#include <arrow/util/bit_util.h>
+#include <arrow/util/bitmap_ops.h>
+#include <arrow/util/compression.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+#include <parquet/statistics.h>
 
-static arrow::Result<shared_ptr<ArrowTable2>> _load_arrow_file(string filename,
-                                                               int64_t dim)
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <thread>
+
+using BatchResult = arrow::Result<shared_ptr<arrow::RecordBatch>>;
+
+// Splits `n` reads across workers. Each worker reads with its own reader,
+// made by `open`, as positional reads of a file are thread-safe but the
+// readers are not.
+template <typename OpenFn, typename ReadFn>
+static arrow::Status read_parallel(int n, OpenFn open, ReadFn read)
+{
+    auto n_workers = min<int>(n, max(1u, thread::hardware_concurrency()));
+
+    vector<future<arrow::Status>> workers;
+    for (int w = 0; w < n_workers; w++) {
+        workers.push_back(async(launch::async, [&, w]() -> arrow::Status {
+            ARROW_ASSIGN_OR_RAISE(auto reader, open());
+            for (int i = w; i < n; i += n_workers) {
+                ARROW_RETURN_NOT_OK(read(*reader, i));
+            }
+            return arrow::Status::OK();
+        }));
+    }
+
+    arrow::Status status;
+    for (auto& worker : workers) { status &= worker.get(); }
+    return status;
+}
+
+// Reads every record batch of an IPC file
+static arrow::Result<arrow::RecordBatchVector> read_batches(
+    shared_ptr<arrow::io::RandomAccessFile> file, int n_batches,
+    const arrow::ipc::IpcReadOptions& options)
 {
+    arrow::RecordBatchVector batches(n_batches);
+    ARROW_RETURN_NOT_OK(read_parallel(
+        n_batches,
+        [&]() {
+            return arrow::ipc::RecordBatchFileReader::Open(file, options);
+        },
+        [&](arrow::ipc::RecordBatchFileReader& reader, int i) {
+            return reader.ReadRecordBatch(i).Value(&batches[i]);
+        }));
+
+    return batches;
+}
+
+// Copies the chunks of a column into one array of `len` rows, dropping each
+// chunk as soon as it is copied. Columns that are not fixed-width are
+// concatenated as a whole instead.
+static arrow::Result<shared_ptr<arrow::Array>> copy_chunks(
+    shared_ptr<arrow::DataType> type, int64_t len, arrow::ArrayVector& chunks)
+{
+    auto* fixed = dynamic_cast<const arrow::FixedWidthType*>(type.get());
+    if (!fixed || type->id() == arrow::Type::DICTIONARY) {
+        return arrow::Concatenate(chunks);
+    }
+    auto bit_width = fixed->bit_width();
+
+    int64_t null_count = 0;
+    for (auto& chunk : chunks) { null_count += chunk->null_count(); }
+
+    shared_ptr<arrow::Buffer> bitmap;
+    if (null_count > 0) {
+        ARROW_ASSIGN_OR_RAISE(bitmap, arrow::AllocateEmptyBitmap(len));
+    }
     ARROW_ASSIGN_OR_RAISE(
-        auto file,
-        arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool()));
+        shared_ptr<arrow::Buffer> values,
+        arrow::AllocateBuffer(arrow::bit_util::BytesForBits(len * bit_width)));
+
+    int64_t row = 0;
+    for (auto& chunk : chunks) {
+        auto& data = *chunk->data();
+        if (bitmap && chunk->null_bitmap_data()) {
+            arrow::internal::CopyBitmap(chunk->null_bitmap_data(), data.offset,
+                                        data.length, bitmap->mutable_data(),
+                                        row);
+        } else if (bitmap) {
+            arrow::bit_util::SetBitsTo(bitmap->mutable_data(), row,
+                                       data.length, true);
+        }
 
-    ARROW_ASSIGN_OR_RAISE(auto ipc_reader,
-                          arrow::ipc::RecordBatchFileReader::Open(file));
+        auto* src = data.buffers[1]->data();
+        if (bit_width == 1) {
+            arrow::internal::CopyBitmap(src, data.offset, data.length,
+                                        values->mutable_data(), row);
+        } else {
+            auto width = bit_width / 8;
+            memcpy(values->mutable_data() + row * width,
+                   src + data.offset * width, data.length * width);
+        }
 
-    ARROW_ASSIGN_OR_RAISE(auto rbatch, ipc_reader->ReadRecordBatch(0));
-    cout << "Input: " << endl << rbatch->ToString() << endl;
+        row += data.length;
+        chunk.reset();
+    }
+
+    return arrow::MakeArray(
+        arrow::ArrayData::Make(type, len, {bitmap, values}, null_count));
+}
+
+// Joins record batches into one, copying the chunks of each column in
+// parallel. Generated code addresses vectors by their global row, so the
+// chunk boundaries disappear here. A single batch is returned as is, and
+// stays backed by the file it was read from. With several batches, each
+// chunk is copied into a column sized for all rows and then dropped, so
+// the batches read and their copy take about as much memory as one of them.
+// The copy is still on the heap, and the file mapping no longer spares
+// loading the columns read; vectors backed by a list of chunks, with loops
+// that walk them chunk by chunk, would keep them in the file but are not
+// implemented yet.
+static BatchResult concat_batches(shared_ptr<arrow::Schema> schema,
+                                  arrow::RecordBatchVector batches)
+{
+    if (batches.empty()) { return arrow::RecordBatch::MakeEmpty(schema); }
+    if (batches.size() == 1) { return batches[0]; }
 
+    int64_t len = 0;
+    vector<arrow::ArrayVector> chunks(schema->num_fields());
+    for (auto& batch : batches) {
+        len += batch->num_rows();
+        for (int col = 0; col < schema->num_fields(); col++) {
+            chunks[col].push_back(batch->column(col));
+        }
+    }
+    batches.clear();
+
+    vector<future<arrow::Result<shared_ptr<arrow::Array>>>> copies;
+    for (int col = 0; col < schema->num_fields(); col++) {
+        copies.push_back(async(launch::async, copy_chunks,
+                               schema->field(col)->type(), len,
+                               ref(chunks[col])));
+    }
+
+    arrow::ArrayVector cols;
+    for (auto& copy : copies) {
+        ARROW_ASSIGN_OR_RAISE(auto col, copy.get());
+        cols.push_back(col);
+    }
+
+    return arrow::RecordBatch::Make(schema, len, cols);
+}
+
+static arrow::Result<shared_ptr<ArrowTable2>> export_batch(
+    const arrow::RecordBatch& rbatch, int64_t dim)
+{
     auto tbl = make_shared<ArrowTable2>(dim);
     ARROW_RETURN_NOT_OK(
-        arrow::ExportRecordBatch(*rbatch, tbl->array, tbl->schema));
+        arrow::ExportRecordBatch(rbatch, tbl->array, tbl->schema));
 
     return tbl;
 }
 
+static arrow::Result<shared_ptr<ArrowTable2>> _load_arrow_file(
+    string filename, int64_t dim, const arrow::ipc::IpcReadOptions& options)
+{
+    // Buffers of a mapped file point into the mapping, so a column is only
+    // paged in once a query reads it
+    ARROW_ASSIGN_OR_RAISE(
+        auto file,
+        arrow::io::MemoryMappedFile::Open(filename, arrow::io::FileMode::READ));
+
+    ARROW_ASSIGN_OR_RAISE(
+        auto ipc_reader,
+        arrow::ipc::RecordBatchFileReader::Open(file, options));
+
+    ARROW_ASSIGN_OR_RAISE(
+        auto batches,
+        read_batches(file, ipc_reader->num_record_batches(), options));
+    ARROW_ASSIGN_OR_RAISE(
+        auto rbatch, concat_batches(ipc_reader->schema(), std::move(batches)));
+
+    return export_batch(*rbatch, dim);
+}
+
 shared_ptr<ArrowTable2> load_arrow_file(string filename, int64_t dim)
 {
-    return _load_arrow_file(filename, dim).ValueOrDie();
+    auto options = arrow::ipc::IpcReadOptions::Defaults();
+    return _load_arrow_file(filename, dim, options).ValueOrDie();
+}
+
+shared_ptr<ArrowTable2> load_arrow_file(string filename, int64_t dim,
+                                        const ColumnSet& cols)
+{
+    // Fields that are not included are neither read nor decompressed
+    auto options = arrow::ipc::IpcReadOptions::Defaults();
+    options.included_fields.assign(cols.begin(), cols.end());
+    return _load_arrow_file(filename, dim, options).ValueOrDie();
+}
+
+template <typename StatsTy>
+static pair<double, double> typed_min_max(const parquet::Statistics& stats)
+{
+    auto& typed = static_cast<const StatsTy&>(stats);
+    return make_pair(typed.min(), typed.max());
+}
+
+// Min and max of a numeric column chunk, if its statistics record them
+static optional<pair<double, double>> min_max(
+    shared_ptr<parquet::Statistics> stats)
+{
+    if (!stats || !stats->HasMinMax()) { return nullopt; }
+
+    switch (stats->physical_type()) {
+        case parquet::Type::INT32:
+            return typed_min_max<parquet::Int32Statistics>(*stats);
+        case parquet::Type::INT64:
+            return typed_min_max<parquet::Int64Statistics>(*stats);
+        case parquet::Type::FLOAT:
+            return typed_min_max<parquet::FloatStatistics>(*stats);
+        case parquet::Type::DOUBLE:
+            return typed_min_max<parquet::DoubleStatistics>(*stats);
+        default:
+            return nullopt;
+    }
+}
+
+static arrow::Result<shared_ptr<ArrowTable2>> _load_parquet_file(
+    string filename, int64_t dim, IterRange range)
+{
+    ARROW_ASSIGN_OR_RAISE(
+        auto file,
+        arrow::io::MemoryMappedFile::Open(filename, arrow::io::FileMode::READ));
+
+    auto open = [&file]() {
+        return parquet::arrow::OpenFile(file, arrow::default_memory_pool());
+    };
+    ARROW_ASSIGN_OR_RAISE(auto reader, open());
+    shared_ptr<arrow::Schema> schema;
+    ARROW_RETURN_NOT_OK(reader->GetSchema(&schema));
+
+    // Row groups whose iterator column, the first one, lies outside the range
+    // are neither read nor decoded
+    auto metadata = reader->parquet_reader()->metadata();
+    vector<int> row_groups;
+    for (int i = 0; i < metadata->num_row_groups(); i++) {
+        auto iter_col = metadata->RowGroup(i)->ColumnChunk(0);
+        auto bounds = min_max(iter_col->statistics());
+        if (!bounds ||
+            (bounds->second >= range.lo && bounds->first <= range.hi)) {
+            row_groups.push_back(i);
+        }
+    }
+
+    arrow::RecordBatchVector batches(row_groups.size());
+    ARROW_RETURN_NOT_OK(read_parallel(
+        row_groups.size(), open,
+        [&](parquet::arrow::FileReader& reader, int i) -> arrow::Status {
+            shared_ptr<arrow::Table> table;
+            ARROW_RETURN_NOT_OK(reader.ReadRowGroup(row_groups[i], &table));
+            return table->CombineChunksToBatch().Value(&batches[i]);
+        }));
+    ARROW_ASSIGN_OR_RAISE(auto rbatch,
+                          concat_batches(schema, std::move(batches)));
+
+    return export_batch(*rbatch, dim);
+}
+
+shared_ptr<ArrowTable2> load_parquet_file(string filename, int64_t dim,
+                                          IterRange range)
+{
+    return _load_parquet_file(filename, dim, range).ValueOrDie();
+}
+
+// End of the CSV field that starts at `p`, which may be quoted
+static const char* field_end(const char* p, const char* end)
+{
+    if (p < end && *p == '"') {
+        for (p++; p < end; p++) {
+            if (*p != '"') { continue; }
+            if (p + 1 == end || p[1] != '"') {
+                p++;
+                break;
+            }
+            p++;  // escaped quote
+        }
+    }
+
+    auto* comma = (const char*)memchr(p, ',', end - p);
+    return comma ? comma : end;
+}
+
+// End of the line that starts at `p`, without its line break
+static pair<const char*, const char*> line_end(const char* p, const char* end)
+{
+    auto* eol = (const char*)memchr(p, '\n', end - p);
+    auto* next = eol ? eol + 1 : end;
+    if (!eol) { eol = end; }
+    if (eol > p && eol[-1] == '\r') { eol--; }
+    return make_pair(eol, next);
+}
+
+// Field [begin, end) without the quotes around it, if any
+static pair<const char*, const char*> unquote(const char* begin,
+                                              const char* end)
+{
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        return make_pair(begin + 1, end - 1);
+    }
+    return make_pair(begin, end);
+}
+
+// Lines are split at every line break, so a quoted field may not hold one.
+// The line that opens such a field has an odd number of quotes, as escaped
+// quotes come in pairs.
+static arrow::Status check_quotes(const char* line, const char* eol)
+{
+    if (count(line, eol, '"') % 2) {
+        return arrow::Status::NotImplemented(
+            "Line break within a quoted CSV field: ", string(line, eol));
+    }
+    return arrow::Status::OK();
+}
+
+using FieldParser = function<arrow::Status(const char*, const char*)>;
+
+template <typename ArrowTy>
+static FieldParser field_parser(arrow::ArrayBuilder* builder)
+{
+    auto* typed = static_cast<arrow::NumericBuilder<ArrowTy>*>(builder);
+    return [typed](const char* begin, const char* end) {
+        typename ArrowTy::c_type val;
+        auto [first, last] = unquote(begin, end);
+        auto [ptr, ec] = from_chars(first, last, val);
+        if (ec != errc() || ptr != last) {
+            return arrow::Status::Invalid("Cannot parse CSV field '",
+                                          string(begin, end), "'");
+        }
+        return typed->Append(val);
+    };
+}
+
+static arrow::Result<shared_ptr<arrow::DataType>> csv_type(DataType dtype)
+{
+    if (dtype == types::BOOL || dtype == types::INT8) {
+        return arrow::int8();
+    } else if (dtype == types::INT16) {
+        return arrow::int16();
+    } else if (dtype == types::INT32) {
+        return arrow::int32();
+    } else if (dtype == types::INT64 || dtype == types::IDX) {
+        return arrow::int64();
+    } else if (dtype == types::FLOAT32) {
+        return arrow::float32();
+    } else if (dtype == types::FLOAT64) {
+        return arrow::float64();
+    }
+    return arrow::Status::NotImplemented("CSV columns of type ", dtype.str());
 }
+
+// Whether the iterator field [begin, end) lies within [lo, hi]. Fields that
+// do not parse are kept, to be reported when the row is parsed.
+template <typename T>
+static bool iter_in_range(const char* begin, const char* end, T lo, T hi)
+{
+    T iter;
+    auto [first, last] = unquote(begin, end);
+    auto [_, ec] = from_chars(first, last, iter);
+    return ec != errc() || (iter >= lo && iter <= hi);
+}
+
+// Integers that `range` holds, as not every integer above 2^53 is a double
+static pair<int64_t, int64_t> int_range(IterRange range)
+{
+    auto to_int = [](double val) {
+        if (val <= (double)INT64_MIN) { return INT64_MIN; }
+        if (val >= (double)INT64_MAX) { return INT64_MAX; }
+        return (int64_t)val;
+    };
+    return make_pair(to_int(ceil(range.lo)), to_int(floor(range.hi)));
+}
+
+// Parses the rows that start in [begin, end) into a record batch of
+// `schema`, whose columns are the CSV fields `fields`. The iterator, the
+// first field, is checked against `range` before any other field of a row
+// is parsed, as an integer unless it is a floating-point column. Numbers
+// may be quoted.
+static BatchResult scan_csv(shared_ptr<arrow::Schema> schema,
+                            const vector<size_t>& fields, DataType iter_type,
+                            IterRange range, const char* begin,
+                            const char* end)
+{
+    vector<unique_ptr<arrow::ArrayBuilder>> builders;
+    vector<FieldParser> parsers;
+    for (auto& field : schema->fields()) {
+        ARROW_ASSIGN_OR_RAISE(auto builder, arrow::MakeBuilder(field->type()));
+        switch (field->type()->id()) {
+            case arrow::Type::INT8:
+                parsers.push_back(field_parser<arrow::Int8Type>(builder.get()));
+                break;
+            case arrow::Type::INT16:
+                parsers.push_back(
+                    field_parser<arrow::Int16Type>(builder.get()));
+                break;
+            case arrow::Type::INT32:
+                parsers.push_back(
+                    field_parser<arrow::Int32Type>(builder.get()));
+                break;
+            case arrow::Type::INT64:
+                parsers.push_back(
+                    field_parser<arrow::Int64Type>(builder.get()));
+                break;
+            case arrow::Type::FLOAT:
+                parsers.push_back(
+                    field_parser<arrow::FloatType>(builder.get()));
+                break;
+            default:
+                parsers.push_back(
+                    field_parser<arrow::DoubleType>(builder.get()));
+                break;
+        }
+        builders.push_back(std::move(builder));
+    }
+
+    bool bounded = isfinite(range.lo) || isfinite(range.hi);
+    bool int_iter = !iter_type.is_float();
+    auto [lo, hi] = int_range(range);
+    bool quoted = memchr(begin, '"', end - begin);
+    for (auto* line = begin; line < end;) {
+        auto [eol, next] = line_end(line, end);
+        auto* row = line;
+        line = next;
+        if (row == eol) { continue; }
+        if (quoted) { ARROW_RETURN_NOT_OK(check_quotes(row, eol)); }
+
+        if (bounded) {
+            auto* iter_end = field_end(row, eol);
+            bool keep =
+                int_iter ? iter_in_range(row, iter_end, lo, hi)
+                         : iter_in_range(row, iter_end, range.lo, range.hi);
+            if (!keep) { continue; }
+        }
+
+        size_t col = 0;
+        auto* p = row;
+        for (size_t field = 0; col < fields.size(); field++) {
+            auto* end_of_field = field_end(p, eol);
+            if (field == fields[col]) {
+                ARROW_RETURN_NOT_OK(parsers[col++](p, end_of_field));
+            }
+            if (end_of_field == eol) { break; }
+            p = end_of_field + 1;
+        }
+        if (col < fields.size()) {
+            return arrow::Status::Invalid("CSV row with too few fields: ",
+                                          string(row, eol));
+        }
+    }
+
+    arrow::ArrayVector cols;
+    for (auto& builder : builders) {
+        ARROW_ASSIGN_OR_RAISE(auto col, builder->Finish());
+        cols.push_back(col);
+    }
+    auto len = cols.empty() ? 0 : cols[0]->length();
+    return arrow::RecordBatch::Make(schema, len, cols);
+}
+
+static arrow::Result<shared_ptr<ArrowTable2>> _load_csv_file(
+    string filename, DataType vecty, const ColumnSet& cols, IterRange range)
+{
+    ARROW_ASSIGN_OR_RAISE(
+        auto file,
+        arrow::io::MemoryMappedFile::Open(filename, arrow::io::FileMode::READ));
+    ARROW_ASSIGN_OR_RAISE(auto size, file->GetSize());
+    ARROW_ASSIGN_OR_RAISE(auto buf, file->ReadAt(0, size));
+    auto* data = (const char*)buf->data();
+    auto* end = data + buf->size();
+
+    auto [header_end, body] = line_end(data, end);
+    ARROW_RETURN_NOT_OK(check_quotes(data, header_end));
+    vector<string> names;
+    for (auto* p = data; p <= header_end; p++) {
+        auto* name_end = field_end(p, header_end);
+        auto [first, last] = unquote(p, name_end);
+        names.push_back(string(first, last));
+        p = name_end;
+    }
+
+    arrow::FieldVector schema_fields;
+    vector<size_t> fields(cols.begin(), cols.end());
+    for (auto field : fields) {
+        if (field >= vecty.dtypes.size() || field >= names.size()) {
+            return arrow::Status::Invalid("No column ", field, " in ",
+                                          filename);
+        }
+        ARROW_ASSIGN_OR_RAISE(auto type, csv_type(vecty.dtypes[field]));
+        schema_fields.push_back(arrow::field(names[field], type));
+    }
+    auto schema = arrow::schema(schema_fields);
+
+    // Each worker scans the rows that start in its share of the file, of at
+    // least a megabyte. A split at a line break within quotes cuts the line
+    // that opens them, which check_quotes rejects.
+    int64_t body_len = end - body;
+    auto n_workers = (int)min<int64_t>(
+        max(1u, thread::hardware_concurrency()), body_len / (1 << 20) + 1);
+    vector<const char*> starts = {body};
+    for (int w = 1; w < n_workers; w++) {
+        auto* p = max(body + body_len * w / n_workers, starts.back());
+        auto* eol = (const char*)memchr(p - 1, '\n', end - (p - 1));
+        starts.push_back(eol ? eol + 1 : end);
+    }
+    starts.push_back(end);
+
+    vector<future<BatchResult>> scans;
+    for (int w = 0; w < n_workers; w++) {
+        scans.push_back(async(launch::async, scan_csv, schema, cref(fields),
+                              vecty.dtypes[0], range, starts[w],
+                              starts[w + 1]));
+    }
+
+    arrow::RecordBatchVector batches;
+    arrow::Status status;
+    for (auto& scan : scans) {
+        auto batch = scan.get();
+        status &= batch.status();
+        if (batch.ok()) { batches.push_back(*batch); }
+    }
+    ARROW_RETURN_NOT_OK(status);
+    ARROW_ASSIGN_OR_RAISE(auto rbatch,
+                          concat_batches(schema, std::move(batches)));
+
+    return export_batch(*rbatch, vecty.dim);
+}
+
+shared_ptr<ArrowTable2> load_csv_file(string filename, DataType vecty,
+                                      IterRange range)
+{
+    ColumnSet cols;
+    for (size_t i = 0; i < vecty.dtypes.size(); i++) { cols.insert(i); }
+    return _load_csv_file(filename, vecty, cols, range).ValueOrDie();
+}
+
+shared_ptr<ArrowTable2> load_csv_file(string filename, DataType vecty,
+                                      const ColumnSet& cols, IterRange range)
+{
+    return _load_csv_file(filename, vecty, cols, range).ValueOrDie();
+}
+
+struct ArrowFileStream::Impl {
+    int64_t dim;
+    int n_batches;
+    int n_issued = 0;
+
+    // Each read in flight has a reader of its own. Batch `i` is read by
+    // reader `i % depth`, whose previous batch has been consumed by then.
+    vector<shared_ptr<arrow::ipc::RecordBatchFileReader>> readers;
+    deque<future<BatchResult>> reads;
+
+    static arrow::Result<unique_ptr<Impl>> Open(string filename, int64_t dim,
+                                                size_t depth)
+    {
+        // Reads go through the file rather than a mapping, so that the
+        // prefetch threads, not the query, wait for the disk
+        ARROW_ASSIGN_OR_RAISE(auto file,
+                              arrow::io::ReadableFile::Open(
+                                  filename, arrow::default_memory_pool()));
+
+        auto impl = make_unique<Impl>();
+        impl->dim = dim;
+        for (size_t k = 0; k < max<size_t>(depth, 1); k++) {
+            ARROW_ASSIGN_OR_RAISE(
+                auto reader, arrow::ipc::RecordBatchFileReader::Open(file));
+            impl->readers.push_back(reader);
+        }
+        impl->n_batches = impl->readers[0]->num_record_batches();
+
+        return impl;
+    }
+
+    void issue()
+    {
+        auto i = this->n_issued++;
+        auto reader = this->readers[i % this->readers.size()];
+        this->reads.push_back(async(launch::async, [reader, i]() {
+            return reader->ReadRecordBatch(i);
+        }));
+    }
+};
+
+ArrowFileStream::ArrowFileStream(string filename, int64_t dim, size_t depth)
+    : _impl(Impl::Open(filename, dim, depth).ValueOrDie())
+{
+    while (_impl->n_issued < _impl->n_batches &&
+           _impl->reads.size() < _impl->readers.size()) {
+        _impl->issue();
+    }
+}
+
+ArrowFileStream::~ArrowFileStream() = default;
+
+shared_ptr<ArrowTable2> ArrowFileStream::next()
+{
+    if (_impl->reads.empty()) { return nullptr; }
+
+    auto rbatch = _impl->reads.front().get().ValueOrDie();
+    _impl->reads.pop_front();
+    if (_impl->n_issued < _impl->n_batches) { _impl->issue(); }
+
+    return export_batch(*rbatch, _impl->dim).ValueOrDie();
+}
+
+// Imports a vector as a record batch without taking ownership of it, so the
+// vector has to outlive the batch
+static BatchResult import_batch(ArrowTable* tbl)
+{
+    ArrowSchema schema = *tbl->schema;
+    schema.release = [](ArrowSchema* s) { s->release = nullptr; };
+    ARROW_ASSIGN_OR_RAISE(auto arrow_schema, arrow::ImportSchema(&schema));
+
+    ArrowArray array = *tbl->array;
+    array.release = [](ArrowArray* a) { a->release = nullptr; };
+    return arrow::ImportRecordBatch(&array, arrow_schema);
+}
+
+struct VectorSink::Impl {
+    bool parquet;
+    arrow::Compression::type codec;
+    int64_t chunk_len;
+    shared_ptr<arrow::io::OutputStream> file;
+    shared_ptr<arrow::ipc::RecordBatchWriter> ipc_writer;
+    unique_ptr<parquet::arrow::FileWriter> parquet_writer;
+    bool closed = false;
+
+    static arrow::Result<unique_ptr<Impl>> Open(string filename, string codec,
+                                                int64_t chunk_len)
+    {
+        auto impl = make_unique<Impl>();
+        impl->parquet = filename.ends_with(".parquet");
+        impl->codec = arrow::Compression::UNCOMPRESSED;
+        if (!codec.empty()) {
+            ARROW_ASSIGN_OR_RAISE(
+                impl->codec, arrow::util::Codec::GetCompressionType(codec));
+        }
+        impl->chunk_len = max<int64_t>(chunk_len, 1);
+        ARROW_ASSIGN_OR_RAISE(impl->file,
+                              arrow::io::FileOutputStream::Open(filename));
+
+        return impl;
+    }
+
+    // Columns are encoded, and compressed, on a thread each
+    arrow::Status open_writer(shared_ptr<arrow::Schema> schema)
+    {
+        if (this->parquet) {
+            auto props = parquet::WriterProperties::Builder()
+                             .compression(this->codec)
+                             ->build();
+            auto arrow_props = parquet::ArrowWriterProperties::Builder()
+                                   .set_use_threads(true)
+                                   ->build();
+            return parquet::arrow::FileWriter::Open(
+                       *schema, arrow::default_memory_pool(), this->file,
+                       props, arrow_props)
+                .Value(&this->parquet_writer);
+        }
+
+        auto options = arrow::ipc::IpcWriteOptions::Defaults();
+        options.use_threads = true;
+        if (this->codec != arrow::Compression::UNCOMPRESSED) {
+            ARROW_ASSIGN_OR_RAISE(options.codec,
+                                  arrow::util::Codec::Create(this->codec));
+        }
+        return arrow::ipc::MakeFileWriter(this->file, schema, options)
+            .Value(&this->ipc_writer);
+    }
+
+    arrow::Status write(ArrowTable* tbl)
+    {
+        ARROW_ASSIGN_OR_RAISE(auto rbatch, import_batch(tbl));
+        if (!this->ipc_writer && !this->parquet_writer) {
+            ARROW_RETURN_NOT_OK(open_writer(rbatch->schema()));
+        }
+
+        if (this->parquet) {
+            ARROW_ASSIGN_OR_RAISE(auto table,
+                                  arrow::Table::FromRecordBatches({rbatch}));
+            return this->parquet_writer->WriteTable(*table, this->chunk_len);
+        }
+
+        for (int64_t i = 0; i < rbatch->num_rows(); i += this->chunk_len) {
+            ARROW_RETURN_NOT_OK(this->ipc_writer->WriteRecordBatch(
+                *rbatch->Slice(i, this->chunk_len)));
+        }
+        return arrow::Status::OK();
+    }
+
+    arrow::Status close()
+    {
+        if (this->closed) { return arrow::Status::OK(); }
+        this->closed = true;
+
+        if (this->parquet_writer) {
+            ARROW_RETURN_NOT_OK(this->parquet_writer->Close());
+        }
+        if (this->ipc_writer) {
+            ARROW_RETURN_NOT_OK(this->ipc_writer->Close());
+        }
+        return this->file->Close();
+    }
+};
+
+static void check(arrow::Status status)
+{
+    if (!status.ok()) { throw runtime_error(status.ToString()); }
+}
+
+VectorSink::VectorSink(string filename, string codec, int64_t chunk_len)
+    : _impl(Impl::Open(filename, codec, chunk_len).ValueOrDie())
+{
+}
+
+VectorSink::~VectorSink() { _impl->close().Warn(); }
+
+void VectorSink::write(ArrowTable* tbl) { check(_impl->write(tbl)); }
+
+void VectorSink::close() { check(_impl->close()); }
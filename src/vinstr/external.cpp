@@ -14,3 +14,17 @@ ArrowTable* build_vector_index(ArrowTable* tbl)
     tbl2->build_index();
     return tbl;
 }
+
+void share_vector_col(ArrowTable* tbl, uint32_t col, ArrowTable* src,
+                      uint32_t src_col)
+{
+    auto tbl2 = reinterpret_cast<ArrowTable2*>(tbl);
+    auto src2 = reinterpret_cast<ArrowTable2*>(src);
+    tbl2->share_column(col, *src2, src_col);
+}
+
+void commit_vector(ArrowTable* tbl, int64_t len)
+{
+    auto tbl2 = reinterpret_cast<ArrowTable2*>(tbl);
+    tbl2->commit(len);
+}
@@ -1 +1,5 @@
+// Emit a definition of every helper (they are otherwise inline and unused
+// here) so that JIT modules can link in the ones they call
+#define REFFINE_VINSTR_ATTR inline __attribute__((used, always_inline))
+
 #include "reffine/vinstr/vinstr.h"
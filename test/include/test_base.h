@@ -7,12 +7,42 @@
 #include "reffine/builder/reffiner.h"
 
 void aggregate_loop_test();
+void aggregate_loop_llvmgen_test();
 void aggregate_op_test(bool = false);
+void aggregate_op_async_test(bool = false);
+void aggregate_op_query_test(bool = false);
+void aggregate_op_multiversion_test(bool = false);
+void aggregate_empty_op_test(bool = false);
+void aggregate_op_param_test(bool = false);
+void aggregate_op_param_acc_test(bool = false);
+void aggregate_op_batch_test(bool = false);
+void aggregate_op_batch_param_test(bool = false);
+void aggregate_op_fusion_test(bool = false);
+void aggregate_op_fusion_hazard_test(bool = false);
+void aggregate_op_pipeline_test(bool = false);
+void aggregate_op_early_exit_test(bool = false);
+void aggregate_op_array_stream_test(bool = false);
+void load_arrow_multi_batch_test();
+void load_arrow_mmap_test();
+void load_arrow_projection_test();
+void load_parquet_test();
+void load_csv_test();
+void load_arrow_stream_test();
 void transform_loop_test();
 void transform_op_test(bool = false);
+void transform_op_spill_test(bool = false);
+void transform_op_sink_test(bool = false);
+void transform_op_pass_through_test(bool = false);
+void transform_op_runend_test(bool = false);
+void transform_op_null_iter_test(bool = false);
+void transform_op_projection_test(bool = false);
 void nested_op_test(bool = false);
 void join_op_test(bool = false);
 void multidim_op_test(bool = false);
+void cse_loop_test();
+void licm_loop_test();
+void affine_bound_test(bool = false);
 void z3solver_test();
+void z3solver_same_name_test();
 
 #endif  // TEST_INCLUDE_TEST_BASE_H_
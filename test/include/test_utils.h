@@ -11,6 +11,7 @@
 #include "arrow/ipc/api.h"
 #include "arrow/result.h"
 #include "arrow/status.h"
+#include "parquet/arrow/writer.h"
 #include "reffine/arrow/table.h"
 #include "reffine/engine/engine.h"
 #include "reffine/pass/canonpass.h"
@@ -26,6 +27,24 @@
 arrow::Result<std::shared_ptr<reffine::ArrowTable2>> get_input_vector(
     std::string, int64_t);
 
+// Exports a record batch as an indexed vector
+arrow::Result<std::shared_ptr<reffine::ArrowTable2>> get_batch_vector(
+    std::shared_ptr<arrow::RecordBatch>, int64_t);
+
+// Rewrites the first record batch of an IPC file into `n_batches` batches
+arrow::Status split_arrow_file(std::string, std::string, int64_t);
+
+// Reader over all record batches of an IPC file
+arrow::Result<std::shared_ptr<arrow::RecordBatchReader>> get_batch_reader(
+    std::string);
+
+// Rewrites the first record batch of an IPC file as a Parquet file with row
+// groups of `row_group_len` rows
+arrow::Status write_parquet_file(std::string, std::string, int64_t);
+
+// Rewrites the first record batch of an IPC file as a CSV file
+arrow::Status write_csv_file(std::string, std::string);
+
 std::string print_arrow_table(ArrowTable*);
 
 typedef void (*gen_table_ty)(void*, int64_t, int64_t);
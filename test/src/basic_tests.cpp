@@ -1,18 +1,110 @@
 #include "test_base.h"
 
 TEST(BasicTests, ReduceLoopTest) { aggregate_loop_test(); }
+TEST(BasicTests, ReduceLoopLLVMGenTest) { aggregate_loop_llvmgen_test(); }
 TEST(BasicTests, ReduceOpTest) { aggregate_op_test(); }
+TEST(BasicTests, ReduceOpAsyncTest) { aggregate_op_async_test(); }
+TEST(BasicTests, ReduceOpQueryTest) { aggregate_op_query_test(); }
+TEST(BasicTests, ReduceOpMultiversionTest) { aggregate_op_multiversion_test(); }
+TEST(BasicTests, ReduceEmptyOpTest) { aggregate_empty_op_test(); }
+TEST(BasicTests, ReduceOpParamTest) { aggregate_op_param_test(); }
+TEST(BasicTests, ReduceOpParamAccTest) { aggregate_op_param_acc_test(); }
+TEST(BasicTests, ReduceOpBatchTest) { aggregate_op_batch_test(); }
+TEST(BasicTests, ReduceOpBatchParamTest) { aggregate_op_batch_param_test(); }
+TEST(BasicTests, ReduceOpFusionTest) { aggregate_op_fusion_test(); }
+TEST(BasicTests, ReduceOpFusionHazardTest)
+{
+    aggregate_op_fusion_hazard_test();
+}
+TEST(BasicTests, ReduceOpPipelineTest) { aggregate_op_pipeline_test(); }
+TEST(BasicTests, ReduceOpEarlyExitTest) { aggregate_op_early_exit_test(); }
+TEST(BasicTests, ReduceOpArrayStreamTest) { aggregate_op_array_stream_test(); }
+TEST(BasicTests, LoadArrowMultiBatchTest) { load_arrow_multi_batch_test(); }
+TEST(BasicTests, LoadArrowMmapTest) { load_arrow_mmap_test(); }
+TEST(BasicTests, LoadArrowProjectionTest) { load_arrow_projection_test(); }
+TEST(BasicTests, LoadParquetTest) { load_parquet_test(); }
+TEST(BasicTests, LoadCsvTest) { load_csv_test(); }
+TEST(BasicTests, LoadArrowStreamTest) { load_arrow_stream_test(); }
 TEST(BasicTests, TransformOpTest) { transform_op_test(); }
+TEST(BasicTests, TransformOpSpillTest) { transform_op_spill_test(); }
+TEST(BasicTests, TransformOpSinkTest) { transform_op_sink_test(); }
+TEST(BasicTests, TransformOpPassThroughTest)
+{
+    transform_op_pass_through_test();
+}
+TEST(BasicTests, TransformOpRunEndTest) { transform_op_runend_test(); }
+TEST(BasicTests, TransformOpNullIterTest) { transform_op_null_iter_test(); }
+TEST(BasicTests, TransformOpProjectionTest) { transform_op_projection_test(); }
 TEST(BasicTests, NestedOpTest) { nested_op_test(); }
 TEST(BasicTests, JoinOpTest) { join_op_test(); }
 TEST(BasicTests, MultiDimOpTest) { multidim_op_test(); }
+TEST(BasicTests, CSELoopTest) { cse_loop_test(); }
+TEST(BasicTests, LICMLoopTest) { licm_loop_test(); }
+TEST(BasicTests, AffineBoundTest) { affine_bound_test(); }
 TEST(BasicTests, Z3SolverTest) { z3solver_test(); }
+TEST(BasicTests, Z3SolverSameNameTest) { z3solver_same_name_test(); }
 
 TEST(VectorizeTests, ReduceOpTest) { aggregate_op_test(true); }
+TEST(VectorizeTests, ReduceOpAsyncTest) { aggregate_op_async_test(true); }
+TEST(VectorizeTests, ReduceOpQueryTest) { aggregate_op_query_test(true); }
+TEST(VectorizeTests, ReduceOpMultiversionTest)
+{
+    aggregate_op_multiversion_test(true);
+}
+TEST(VectorizeTests, ReduceEmptyOpTest) { aggregate_empty_op_test(true); }
+TEST(VectorizeTests, ReduceOpParamTest) { aggregate_op_param_test(true); }
+TEST(VectorizeTests, ReduceOpParamAccTest)
+{
+    aggregate_op_param_acc_test(true);
+}
+TEST(VectorizeTests, ReduceOpBatchTest) { aggregate_op_batch_test(true); }
+TEST(VectorizeTests, ReduceOpBatchParamTest)
+{
+    aggregate_op_batch_param_test(true);
+}
+TEST(VectorizeTests, ReduceOpFusionTest)
+{
+    aggregate_op_fusion_test(true);
+}
+TEST(VectorizeTests, ReduceOpFusionHazardTest)
+{
+    aggregate_op_fusion_hazard_test(true);
+}
+TEST(VectorizeTests, ReduceOpPipelineTest)
+{
+    aggregate_op_pipeline_test(true);
+}
+TEST(VectorizeTests, ReduceOpEarlyExitTest)
+{
+    aggregate_op_early_exit_test(true);
+}
+TEST(VectorizeTests, ReduceOpArrayStreamTest)
+{
+    aggregate_op_array_stream_test(true);
+}
 TEST(VectorizeTests, TransformOpTest) { transform_op_test(true); }
+TEST(VectorizeTests, TransformOpSpillTest)
+{
+    transform_op_spill_test(true);
+}
+TEST(VectorizeTests, TransformOpSinkTest) { transform_op_sink_test(true); }
+TEST(VectorizeTests, TransformOpPassThroughTest)
+{
+    transform_op_pass_through_test(true);
+}
+TEST(VectorizeTests, TransformOpRunEndTest) { transform_op_runend_test(true); }
+TEST(VectorizeTests, TransformOpNullIterTest)
+{
+    transform_op_null_iter_test(true);
+}
+TEST(VectorizeTests, TransformOpProjectionTest)
+{
+    transform_op_projection_test(true);
+}
 TEST(VectorizeTests, NestedOpTest) { nested_op_test(true); }
 TEST(VectorizeTests, JoinOpTest) { join_op_test(true); }
 TEST(VectorizeTests, MultiDimOpTest) { multidim_op_test(true); }
+TEST(VectorizeTests, AffineBoundTest) { affine_bound_test(true); }
 
 int main(int argc, char **argv)
 {
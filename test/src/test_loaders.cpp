@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <fstream>
+
+#include "test_base.h"
+#include "test_utils.h"
+
+using namespace std;
+using namespace reffine;
+
+// Whether column `col` of `tbl` holds the values of column `ref_col` of
+// `ref` from row `row` on. All columns of the students file are int64.
+static bool same_values(shared_ptr<ArrowTable2> tbl, uint32_t col,
+                        shared_ptr<ArrowTable2> ref, uint32_t ref_col,
+                        int64_t row = 0)
+{
+    auto* vals = (int64_t*)get_vector_data_buf(tbl.get(), col);
+    auto* ref_vals = (int64_t*)get_vector_data_buf(ref.get(), ref_col);
+    return equal(vals, vals + tbl->array->length, ref_vals + row);
+}
+
+// Whether `tbl` holds the same columns as `ref`, e.g. the students file
+static bool same_table(shared_ptr<ArrowTable2> tbl,
+                       shared_ptr<ArrowTable2> ref)
+{
+    if (tbl->array->length != ref->array->length ||
+        tbl->schema->n_children != ref->schema->n_children) {
+        return false;
+    }
+    for (int64_t col = 0; col < tbl->schema->n_children; col++) {
+        if (!same_values(tbl, col, ref, col)) { return false; }
+    }
+    return true;
+}
+
+// Number of rows of `tbl` whose iterator lies within [lo, hi]
+static int64_t rows_in_range(shared_ptr<ArrowTable2> tbl, int64_t lo,
+                             int64_t hi)
+{
+    auto* iters = (int64_t*)get_vector_data_buf(tbl.get(), 0);
+    int64_t count = 0;
+    for (int64_t i = 0; i < tbl->array->length; i++) {
+        count += (iters[i] >= lo && iters[i] <= hi);
+    }
+    return count;
+}
+
+void load_arrow_multi_batch_test()
+{
+    auto filename = string("students_batches.arrow");
+    auto status = split_arrow_file(STUDENTS_ARROW_FILE, filename, 3);
+    ASSERT_TRUE(status.ok()) << status.ToString();
+    auto ref = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+
+    // The batches are joined into one heap copy of each column
+    auto* pool = arrow::default_memory_pool();
+    auto allocated = pool->bytes_allocated();
+    auto tbl = load_arrow_file(filename, 1);
+    auto n_cols = ref->schema->n_children;
+    auto col_bytes = ref->array->length * (int64_t)sizeof(int64_t);
+    ASSERT_GE(pool->bytes_allocated() - allocated, n_cols * col_bytes);
+    ASSERT_LE(pool->bytes_allocated() - allocated, n_cols * (col_bytes + 64));
+
+    ASSERT_TRUE(same_table(tbl, ref));
+}
+
+void load_arrow_mmap_test()
+{
+    auto ref = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+
+    // The columns of a single-batch file are not copied to the heap
+    auto* pool = arrow::default_memory_pool();
+    auto allocated = pool->bytes_allocated();
+    auto tbl = load_arrow_file(STUDENTS_ARROW_FILE, 1);
+    ASSERT_EQ(pool->bytes_allocated(), allocated);
+
+    ASSERT_TRUE(same_table(tbl, ref));
+}
+
+void load_arrow_projection_test()
+{
+    auto ref = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+
+    auto* pool = arrow::default_memory_pool();
+    auto allocated = pool->bytes_allocated();
+    auto tbl = load_arrow_file(STUDENTS_ARROW_FILE, 1, ColumnSet{0, 2});
+    ASSERT_EQ(pool->bytes_allocated(), allocated);
+
+    // Only the included fields are loaded, in the order of the file
+    ASSERT_EQ(tbl->schema->n_children, 2);
+    ASSERT_EQ(tbl->array->length, ref->array->length);
+    ASSERT_STREQ(tbl->schema->children[0]->name,
+                 ref->schema->children[0]->name);
+    ASSERT_STREQ(tbl->schema->children[1]->name,
+                 ref->schema->children[2]->name);
+    ASSERT_TRUE(same_values(tbl, 0, ref, 0));
+    ASSERT_TRUE(same_values(tbl, 1, ref, 2));
+}
+
+void load_parquet_test()
+{
+    auto filename = string("students.parquet");
+    auto status = write_parquet_file(STUDENTS_ARROW_FILE, filename, 8);
+    ASSERT_TRUE(status.ok()) << status.ToString();
+    auto ref = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+
+    auto full_tbl = load_parquet_file(filename, 1);
+    ASSERT_TRUE(same_table(full_tbl, ref));
+
+    // Row groups are kept whole if any of their rows lies in the range
+    auto* iters = (int64_t*)get_vector_data_buf(ref.get(), 0);
+    auto len = ref->array->length;
+    int64_t n_kept = 0;
+    for (int64_t begin = 0; begin < len; begin += 8) {
+        auto end = min<int64_t>(begin + 8, len);
+        auto [lo, hi] = minmax_element(iters + begin, iters + end);
+        if (*hi >= 10 && *lo <= 48) { n_kept += end - begin; }
+    }
+
+    auto tbl = load_parquet_file(filename, 1, IterRange{10, 48});
+    ASSERT_LT(tbl->array->length, len);
+    ASSERT_EQ(tbl->array->length, n_kept);
+    ASSERT_EQ(rows_in_range(tbl, 10, 48), rows_in_range(ref, 10, 48));
+
+    // No row group holds rows of an out-of-range scan
+    auto empty_tbl = load_parquet_file(filename, 1, IterRange{1000, 2000});
+    ASSERT_EQ(empty_tbl->array->length, 0);
+}
+
+void load_csv_test()
+{
+    auto filename = string("students.csv");
+    auto status = write_csv_file(STUDENTS_ARROW_FILE, filename);
+    ASSERT_TRUE(status.ok()) << status.ToString();
+    auto ref = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+
+    auto full_tbl = load_csv_file(filename, ref->get_data_type());
+    ASSERT_TRUE(same_table(full_tbl, ref));
+
+    // Rows are dropped one by one, so exactly those in the range remain, with
+    // only the given fields
+    auto tbl = load_csv_file(filename, ref->get_data_type(), ColumnSet{0, 2},
+                             IterRange{10, 48});
+    ASSERT_EQ(tbl->schema->n_children, 2);
+    ASSERT_LT(tbl->array->length, ref->array->length);
+    ASSERT_EQ(tbl->array->length, rows_in_range(ref, 10, 48));
+
+    auto* ref_iters = (int64_t*)get_vector_data_buf(ref.get(), 0);
+    auto* ref_vals = (int64_t*)get_vector_data_buf(ref.get(), 2);
+    vector<int64_t> iters, vals;
+    for (int64_t i = 0; i < ref->array->length; i++) {
+        if (ref_iters[i] >= 10 && ref_iters[i] <= 48) {
+            iters.push_back(ref_iters[i]);
+            vals.push_back(ref_vals[i]);
+        }
+    }
+    auto* tbl_iters = (int64_t*)get_vector_data_buf(tbl.get(), 0);
+    auto* tbl_vals = (int64_t*)get_vector_data_buf(tbl.get(), 1);
+    ASSERT_TRUE(equal(iters.begin(), iters.end(), tbl_iters));
+    ASSERT_TRUE(equal(vals.begin(), vals.end(), tbl_vals));
+
+    // Iterators past 2^53 are checked against the range exactly, where
+    // 2^53 + 1 would compare equal to 2^53 as a double
+    auto big_filename = string("big_iters.csv");
+    int64_t big = (int64_t)1 << 53;
+    ofstream(big_filename) << "t,v\n" << big << ",1\n" << big + 1 << ",2\n";
+    auto big_range = IterRange{(double)big, (double)big};
+    auto big_tbl = load_csv_file(big_filename, ref->get_data_type(),
+                                 ColumnSet{0}, big_range);
+    ASSERT_EQ(big_tbl->array->length, 1);
+    ASSERT_EQ(((int64_t*)get_vector_data_buf(big_tbl.get(), 0))[0], big);
+
+    // Quoted numbers are parsed without their quotes
+    auto quoted_filename = string("quoted.csv");
+    ofstream(quoted_filename) << "\"t\",\"v\"\n\"12\",1\n13,\"2\"\n";
+    auto quoted_tbl = load_csv_file(quoted_filename, ref->get_data_type(),
+                                    ColumnSet{0, 1}, IterRange{12, 12});
+    ASSERT_EQ(quoted_tbl->array->length, 1);
+    ASSERT_EQ(((int64_t*)get_vector_data_buf(quoted_tbl.get(), 0))[0], 12);
+    ASSERT_EQ(((int64_t*)get_vector_data_buf(quoted_tbl.get(), 1))[0], 1);
+
+    // Line breaks within quotes are rejected rather than split into rows
+    auto break_filename = string("quoted_break.csv");
+    ofstream(break_filename) << "t,v\n1,\"2\n3\"\n";
+    ASSERT_DEATH(load_csv_file(break_filename, ref->get_data_type(),
+                               ColumnSet{0}),
+                 "Line break within a quoted CSV field");
+}
+
+void load_arrow_stream_test()
+{
+    auto filename = string("students_stream.arrow");
+    auto status = split_arrow_file(STUDENTS_ARROW_FILE, filename, 3);
+    ASSERT_TRUE(status.ok()) << status.ToString();
+    auto ref = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+
+    // The chunks are the batches of the file, in order
+    ArrowFileStream stream(filename, 1, 2);
+    int64_t row = 0;
+    int n_chunks = 0;
+    while (auto chunk = stream.next()) {
+        ASSERT_EQ(chunk->schema->n_children, ref->schema->n_children);
+        ASSERT_LE(row + chunk->array->length, ref->array->length);
+        for (int64_t col = 0; col < ref->schema->n_children; col++) {
+            ASSERT_TRUE(same_values(chunk, col, ref, col, row));
+        }
+        row += chunk->array->length;
+        n_chunks++;
+    }
+    ASSERT_EQ(n_chunks, 3);
+    ASSERT_EQ(row, ref->array->length);
+}
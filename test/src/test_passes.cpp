@@ -0,0 +1,291 @@
+#include "reffine/builder/reffiner.h"
+#include "reffine/pass/csepass.h"
+#include "reffine/pass/licmpass.h"
+#include "reffine/pass/readwritepass.h"
+#include "reffine/vinstr/vinstr.h"
+#include "test_base.h"
+#include "test_utils.h"
+
+using namespace reffine;
+using namespace reffine::reffiner;
+
+// Column 1 of the students table, which the loops below read
+static vector<int64_t> students_col(ArrowTable* tbl)
+{
+    auto* data = (int64_t*)get_vector_data_buf(tbl, 1);
+    return vector<int64_t>(data, data + get_vector_len(tbl));
+}
+
+// Sums 4 * val over the rows with val > 50 and 2 * val + 1 over the rest,
+// then 2 * val over all rows again, reading val through guarded ReadData
+shared_ptr<Func> cse_loop(shared_ptr<ArrowTable2> tbl)
+{
+    auto vec_sym = _sym("vec", tbl->get_data_type());
+    auto len = _call("get_vector_len", _idx_t, vector<Expr>{vec_sym});
+    auto len_sym = _sym("len", len);
+
+    auto idx_alloc = _alloc(_idx_t);
+    auto idx_addr = _sym("idx_addr", idx_alloc);
+    auto sum_alloc = _alloc(_i64_t);
+    auto sum_addr = _sym("sum_addr", sum_alloc);
+    auto idx = _load(idx_addr);
+    auto idx_sym = _sym("idx", idx);
+    auto val = _load(_fetch(vec_sym, 1), idx_sym);
+    auto val_sym = _sym("val", val);
+
+    auto twice = [&]() { return _mul(val_sym, _i64(2)); };
+    auto guarded_read = [&]() {
+        return _sel(_lt(idx_sym, len_sym), _readdata(vec_sym, idx_sym, 1),
+                    _i64(0));
+    };
+
+    auto loop = _loop(_load(sum_addr));
+    auto loop_sym = _sym("loop", loop);
+    loop->init = _stmts(vector<Expr>{
+        _store(idx_addr, _idx(0)),
+        _store(sum_addr, _i64(0)),
+    });
+    loop->exit_cond = _gte(_load(idx_addr), len_sym);
+    loop->body = _stmts(vector<Expr>{
+        _ifelse(_gt(val_sym, _i64(50)),
+                _stmts(vector<Expr>{_store(
+                    sum_addr, _add(_add(_load(sum_addr), twice()), twice()))}),
+                _stmts(vector<Expr>{_store(
+                    sum_addr,
+                    _add(_load(sum_addr), _add(twice(), _i64(1))))})),
+        _store(sum_addr,
+               _add(_load(sum_addr), _add(guarded_read(), guarded_read()))),
+        _store(idx_addr, _add(idx_sym, _idx(1))),
+    });
+
+    auto foo_fn = _func("foo_cse", loop_sym, vector<Sym>{vec_sym});
+    foo_fn->tbl[len_sym] = len;
+    foo_fn->tbl[idx_addr] = idx_alloc;
+    foo_fn->tbl[sum_addr] = sum_alloc;
+    foo_fn->tbl[idx_sym] = idx;
+    foo_fn->tbl[val_sym] = val;
+    foo_fn->tbl[loop_sym] = loop;
+
+    return foo_fn;
+}
+
+void cse_loop_test()
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto cse_fn = CSEPass::Build(cse_loop(tbl));
+    auto loop = static_pointer_cast<Loop>(cse_fn->tbl.at(cse_fn->output));
+    auto body = static_pointer_cast<Stmts>(loop->body);
+    auto branch_val = [](Expr branch) {
+        auto stmts = static_pointer_cast<Stmts>(branch);
+        return static_pointer_cast<Store>(stmts->stmts[0])->val;
+    };
+
+    // Within a branch, the repeated product is computed once
+    auto ifelse = static_pointer_cast<IfElse>(body->stmts[0]);
+    auto true_val =
+        static_pointer_cast<NaryExpr>(branch_val(ifelse->true_body));
+    auto cse_sym = dynamic_pointer_cast<SymNode>(true_val->arg(1));
+    ASSERT_TRUE(cse_sym);
+    ASSERT_EQ(static_pointer_cast<NaryExpr>(true_val->arg(0))->arg(1), cse_sym);
+
+    // The other branch is another scope, so the product is not reused there
+    auto false_val =
+        static_pointer_cast<NaryExpr>(branch_val(ifelse->false_body));
+    auto false_sum = static_pointer_cast<NaryExpr>(false_val->arg(1));
+    ASSERT_FALSE(dynamic_pointer_cast<SymNode>(false_sum->arg(0)));
+
+    // Guarded reads are not hoisted out of their guards
+    auto read_val = static_pointer_cast<NaryExpr>(
+        static_pointer_cast<Store>(body->stmts[1])->val);
+    auto reads = static_pointer_cast<NaryExpr>(read_val->arg(1));
+    for (auto& read : reads->args) {
+        auto sel = static_pointer_cast<Select>(read);
+        ASSERT_TRUE(dynamic_pointer_cast<ReadData>(sel->true_body));
+    }
+
+    long expected = 0;
+    for (auto val : students_col(tbl.get())) {
+        expected += (val > 50 ? 4 * val : 2 * val + 1) + 2 * val;
+    }
+
+    long output = -1;
+    auto query_fn = compile_loop<void (*)(long*, void*)>(cse_loop(tbl));
+    query_fn(&output, tbl.get());
+    ASSERT_EQ(output, expected);
+}
+
+// Sums column 1 twice per row, once through FetchDataPtr and once through
+// ReadData, plus 100 / k when k > 0, in an inner loop that the outer loop
+// runs twice
+shared_ptr<Func> licm_loop(shared_ptr<ArrowTable2> tbl, string name)
+{
+    auto vec_sym = _sym("vec", tbl->get_data_type());
+    auto k_sym = _sym("k", _i64_t);
+    auto len = _call("get_vector_len", _idx_t, vector<Expr>{vec_sym});
+    auto len_sym = _sym("len", len);
+
+    auto idx_alloc = _alloc(_idx_t);
+    auto idx_addr = _sym("idx_addr", idx_alloc);
+    auto rep_alloc = _alloc(_i64_t);
+    auto rep_addr = _sym("rep_addr", rep_alloc);
+    auto inner_alloc = _alloc(_i64_t);
+    auto inner_addr = _sym("inner_addr", inner_alloc);
+    auto sum_alloc = _alloc(_i64_t);
+    auto sum_addr = _sym("sum_addr", sum_alloc);
+
+    auto add_inner = [&](Expr val) {
+        return _store(inner_addr, _add(_load(inner_addr), val));
+    };
+
+    auto inner = _loop(_load(inner_addr));
+    auto inner_sym = _sym("inner", inner);
+    inner->init = _stmts(vector<Expr>{
+        _store(idx_addr, _idx(0)),
+        _store(inner_addr, _i64(0)),
+    });
+    inner->exit_cond = _gte(_load(idx_addr), len_sym);
+    inner->body = _stmts(vector<Expr>{
+        add_inner(_load(_fetch(vec_sym, 1), _load(idx_addr))),
+        add_inner(_readdata(vec_sym, _load(idx_addr), 1)),
+        _ifelse(_gt(k_sym, _i64(0)),
+                _stmts(vector<Expr>{add_inner(_div(_i64(100), k_sym))}),
+                _noop()),
+        _store(idx_addr, _add(_load(idx_addr), _idx(1))),
+    });
+
+    auto outer = _loop(_load(sum_addr));
+    auto outer_sym = _sym("outer", outer);
+    outer->init = _stmts(vector<Expr>{
+        _store(rep_addr, _i64(0)),
+        _store(sum_addr, _i64(0)),
+    });
+    outer->exit_cond = _gte(_load(rep_addr), _i64(2));
+    outer->body = _stmts(vector<Expr>{
+        _store(sum_addr, _add(_load(sum_addr), inner_sym)),
+        _store(rep_addr, _add(_load(rep_addr), _i64(1))),
+    });
+
+    auto foo_fn = _func(name, outer_sym, vector<Sym>{vec_sym, k_sym});
+    foo_fn->tbl[len_sym] = len;
+    foo_fn->tbl[idx_addr] = idx_alloc;
+    foo_fn->tbl[rep_addr] = rep_alloc;
+    foo_fn->tbl[inner_addr] = inner_alloc;
+    foo_fn->tbl[sum_addr] = sum_alloc;
+    foo_fn->tbl[inner_sym] = inner;
+    foo_fn->tbl[outer_sym] = outer;
+
+    return foo_fn;
+}
+
+void licm_loop_test()
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto licm_fn =
+        LICMPass::Build(ReadWritePass().eval(licm_loop(tbl, "foo_licm")));
+
+    shared_ptr<Loop> outer, inner;
+    for (auto& [sym, val] : licm_fn->tbl) {
+        if (auto loop = dynamic_pointer_cast<Loop>(val)) {
+            (sym == licm_fn->output ? outer : inner) = loop;
+        }
+    }
+    ASSERT_TRUE(outer && inner);
+
+    // The buffer pointers of the inner loop are computed once, before the
+    // outer loop, and the division stays under its guard
+    bool fetch_hoisted = false;
+    bool call_hoisted = false;
+    for (auto& stmt : static_pointer_cast<Stmts>(outer->init)->stmts) {
+        auto sym = dynamic_pointer_cast<SymNode>(stmt);
+        if (!sym) { continue; }
+
+        auto val = licm_fn->tbl.at(sym);
+        fetch_hoisted |= (dynamic_pointer_cast<FetchDataPtr>(val) != nullptr);
+        if (auto cast = dynamic_pointer_cast<Cast>(val)) {
+            auto call = dynamic_pointer_cast<Call>(cast->arg);
+            call_hoisted |= (call && call->name == "get_array_buf");
+        }
+        auto nary = dynamic_pointer_cast<NaryExpr>(val);
+        ASSERT_FALSE(nary && nary->op == MathOp::DIV);
+    }
+    ASSERT_TRUE(fetch_hoisted);
+    ASSERT_TRUE(call_hoisted);
+    ASSERT_EQ(static_pointer_cast<Stmts>(inner->init)->stmts.size(), 2u);
+
+    auto col = students_col(tbl.get());
+    long col_sum = 0;
+    for (auto val : col) { col_sum += val; }
+
+    // With k = 0 the hoisted division would trap
+    auto query_fn =
+        compile_loop<void (*)(long*, void*, long)>(licm_loop(tbl, "foo_licm"));
+    for (long k : {0, 7}) {
+        long output = -1;
+        query_fn(&output, tbl.get(), k);
+        long per_row = k > 0 ? 100 / k : 0;
+        ASSERT_EQ(output, 2 * (2 * col_sum + (long)col.size() * per_row));
+    }
+}
+
+// Sum of column 2 over the rows with lo < t < hi
+static shared_ptr<Func> strict_sum_op(shared_ptr<ArrowTable2> tbl, string name,
+                                      Expr lo, Expr hi, vector<Sym> params)
+{
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto op = _op(vector<Sym>{t_sym},
+                  _in(t_sym, vec_in_sym) & _gt(t_sym, lo) & _lt(t_sym, hi),
+                  vector<Expr>{vec_in_sym[{t_sym}][2]});
+    auto sum = _red(
+        op, []() { return _i64(0); },
+        [](Expr s, Expr v) { return _add(s, _get(v, 0)); });
+    auto sum_sym = _sym("sum", sum);
+
+    params.insert(params.begin(), vec_in_sym);
+    auto foo_fn = _func(name, sum_sym, params);
+    foo_fn->tbl[sum_sym] = sum;
+
+    return foo_fn;
+}
+
+void affine_bound_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto suffix = string(vectorize ? "_vec" : "");
+
+    // Strict constant bounds are tightened by one
+    auto const_fn = strict_sum_op(tbl, "foo_affine_const" + suffix, _i64(9),
+                                  _i64(49), vector<Sym>{});
+    auto range = Reffine::ScanRange(const_fn, const_fn->inputs[0]);
+    ASSERT_EQ(range.lo, 10);
+    ASSERT_EQ(range.hi, 48);
+
+    long output = -1;
+    auto const_query = compile_op<void (*)(long*, void*)>(const_fn, vectorize);
+    const_query(&output, tbl.get());
+    ASSERT_EQ(output, 696);
+
+    // Bounds on parameters are affine in them, but not constant
+    auto lo_sym = _sym("lo", _i64_t);
+    auto hi_sym = _sym("hi", _i64_t);
+    auto param_fn = strict_sum_op(tbl, "foo_affine_param" + suffix, lo_sym,
+                                  hi_sym, vector<Sym>{lo_sym, hi_sym});
+    range = Reffine::ScanRange(param_fn, param_fn->inputs[0]);
+    ASSERT_EQ(range.lo, -INFINITY);
+    ASSERT_EQ(range.hi, INFINITY);
+
+    auto param_query =
+        compile_op<void (*)(long*, void*, long, long)>(param_fn, vectorize);
+    param_query(&output, tbl.get(), 9, 49);
+    ASSERT_EQ(output, 696);
+    param_query(&output, tbl.get(), 48, 10);
+    ASSERT_EQ(output, 0);
+
+    long inner = -1;
+    auto inner_fn = strict_sum_op(tbl, "foo_affine_inner" + suffix, _i64(10),
+                                  _i64(48), vector<Sym>{});
+    auto inner_query = compile_op<void (*)(long*, void*)>(inner_fn, vectorize);
+    inner_query(&inner, tbl.get());
+    param_query(&output, tbl.get(), 10, 48);
+    ASSERT_EQ(output, inner);
+}
@@ -1,4 +1,7 @@
 #include "reffine/builder/reffiner.h"
+#include "reffine/pass/condelimpass.h"
+#include "reffine/pass/fusepass.h"
+#include "reffine/pass/pipelinepass.h"
 #include "test_base.h"
 #include "test_utils.h"
 
@@ -58,6 +61,33 @@ void aggregate_loop_test()
     ASSERT_EQ(output, 131977);
 }
 
+void aggregate_loop_llvmgen_test()
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto loop = vector_loop(tbl);
+    loop->name = "foo_llvmgen";
+    long output = 0;
+    auto query_fn = compile_loop<void (*)(long*, void*)>(loop, false);
+
+    query_fn(&output, tbl.get());
+
+    ASSERT_EQ(output, 131977);
+
+    // The loop carries its hints, and buffer accesses their TBAA type and
+    // alias scope
+    auto ir_loop = vector_loop(tbl);
+    ir_loop->name = "foo_llvmgen_ir";
+    llvm::LLVMContext llctx;
+    auto llmod = gen_module(ir_loop, llctx, false);
+    string ir;
+    llvm::raw_string_ostream os(ir);
+    llmod->getFunction(ir_loop->name)->print(os);
+    os.flush();
+    for (auto md : {"!llvm.loop", "!tbaa", "!alias.scope", "!noalias"}) {
+        ASSERT_NE(ir.find(md), string::npos) << md;
+    }
+}
+
 shared_ptr<Func> vector_op(shared_ptr<ArrowTable2> tbl)
 {
     auto t_sym = _sym("t", _i64_t);
@@ -120,3 +150,574 @@ void aggregate_op_test(bool vectorize)
 
     ASSERT_EQ(output, 696);
 }
+
+void aggregate_op_async_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+
+    vector<future<void (*)(long*, void*)>> query_fns;
+    for (int i = 0; i < 4; i++) {
+        auto op = vector_op(tbl);
+        op->name = "foo_async_" + to_string(i) + (vectorize ? "_vec" : "");
+        query_fns.push_back(
+            compile_op_async<void (*)(long*, void*)>(op, vectorize));
+    }
+
+    for (auto& query_fn : query_fns) {
+        long output = 0;
+        query_fn.get()(&output, tbl.get());
+        ASSERT_EQ(output, 696);
+    }
+}
+
+void aggregate_op_query_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto jit = ExecEngine::Get();
+
+    // The same name can be reused once the previous query has been dropped
+    for (int i = 0; i < 2; i++) {
+        auto op = vector_op(tbl);
+        op->name = "foo_query";
+        auto query = compile_query(op, vectorize);
+        auto mem_usage = jit->MemoryUsage();
+        ASSERT_GT(mem_usage, 0);
+
+        long output = 0;
+        query->get<void (*)(long*, void*)>()(&output, tbl.get());
+        ASSERT_EQ(output, 696);
+
+        query.reset();
+        ASSERT_LT(jit->MemoryUsage(), mem_usage);
+    }
+}
+
+void aggregate_op_multiversion_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto op = vector_op(tbl);
+    op->name = string("foo_multiversion") + (vectorize ? "_vec" : "");
+
+    auto jit = ExecEngine::Get();
+    auto loop = gen_loop(op, vectorize);
+    jit->AddModule(gen_multiversion_module(loop, jit->GetCtx()));
+    auto query_fn = jit->LookupVariant<void (*)(long*, void*)>(loop->name);
+
+    long output = 0;
+    query_fn(&output, tbl.get());
+
+    ASSERT_EQ(output, 696);
+}
+
+void aggregate_empty_op_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto op = _op(
+        vector<Sym>{t_sym},
+        _in(t_sym, vec_in_sym) & _lte(t_sym, _i64(10)) & _gte(t_sym, _i64(48)),
+        vector<Expr>{vec_in_sym[{t_sym}][2]});
+    auto sum = _red(
+        op, []() { return _i64(0); },
+        [](Expr s, Expr v) { return _add(s, _get(v, 1)); });
+    auto sum_sym = _sym("sum", sum);
+
+    auto foo_fn = _func(string("foo_empty") + (vectorize ? "_vec" : ""),
+                        sum_sym, vector<Sym>{vec_in_sym});
+    foo_fn->tbl[sum_sym] = sum;
+
+    // The refuted predicate leaves no reduction to run
+    auto elim_fn = CondElimPass::Build(foo_fn);
+    for (auto& [sym, def] : elim_fn->tbl) {
+        ASSERT_FALSE(dynamic_pointer_cast<Reduce>(def));
+        ASSERT_FALSE(dynamic_pointer_cast<Op>(def));
+        ASSERT_FALSE(dynamic_pointer_cast<Loop>(def));
+    }
+    auto init = dynamic_pointer_cast<Const>(elim_fn->tbl.at(sum_sym));
+    ASSERT_TRUE(init);
+    ASSERT_EQ(init->val, 0);
+
+    long output = -1;
+    auto query_fn = compile_op<void (*)(long*, void*)>(foo_fn, vectorize);
+    query_fn(&output, tbl.get());
+
+    ASSERT_EQ(output, 0);
+}
+
+void aggregate_op_param_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto t_sym = _sym("t", _i64_t);
+    auto lo_sym = _sym("lo", _i64_t);
+    auto hi_sym = _sym("hi", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto op = _op(
+        vector<Sym>{t_sym},
+        _in(t_sym, vec_in_sym) & _lte(t_sym, hi_sym) & _gte(t_sym, lo_sym),
+        vector<Expr>{vec_in_sym[{t_sym}][2]});
+    auto sum = _red(
+        op, []() { return _i64(0); },
+        [](Expr s, Expr v) { return _add(s, _get(v, 0)); });
+    auto sum_sym = _sym("sum", sum);
+
+    auto foo_fn = _func(string("foo_param") + (vectorize ? "_vec" : ""),
+                        sum_sym, vector<Sym>{vec_in_sym, lo_sym, hi_sym});
+    foo_fn->tbl[sum_sym] = sum;
+
+    using QueryFnTy = void (*)(long*, void*, long, long);
+    PreparedQuery<QueryFnTy> query(foo_fn, vectorize);
+
+    long output = 0;
+    query.get()(&output, tbl.get(), 10, 48);
+    ASSERT_EQ(output, 696);
+    query.get()(&output, tbl.get(), 48, 10);
+    ASSERT_EQ(output, 0);
+
+    auto spec_fn = query.specialize({{lo_sym, _i64(10)}, {hi_sym, _i64(48)}});
+    spec_fn(&output, tbl.get(), 0, 0);
+    ASSERT_EQ(output, 696);
+}
+
+void aggregate_op_param_acc_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto t_sym = _sym("t", _i64_t);
+    auto base_sym = _sym("base", _i64_t);
+    auto w_sym = _sym("w", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto op = _op(
+        vector<Sym>{t_sym},
+        _in(t_sym, vec_in_sym) & _lte(t_sym, _i64(48)) & _gte(t_sym, _i64(10)),
+        vector<Expr>{vec_in_sym[{t_sym}][2]});
+
+    // The Reduce lambdas capture the parameters, so the passes that clone
+    // the op before LoopGen must keep the parameter symbols
+    auto sum = _red(
+        op, [base_sym]() { return base_sym; },
+        [w_sym](Expr s, Expr v) { return _add(s, _mul(_get(v, 0), w_sym)); });
+    auto sum_sym = _sym("sum", sum);
+
+    auto foo_fn = _func(string("foo_param_acc") + (vectorize ? "_vec" : ""),
+                        sum_sym, vector<Sym>{vec_in_sym, base_sym, w_sym});
+    foo_fn->tbl[sum_sym] = sum;
+
+    auto query_fn =
+        compile_op<void (*)(long*, void*, long, long)>(foo_fn, vectorize);
+    long output = -1;
+    query_fn(&output, tbl.get(), 5, 3);
+    ASSERT_EQ(output, 5 + 696 * 3);
+}
+
+// Sum, or count, of column 2 over the rows with lo <= t <= hi
+static shared_ptr<Reduce> range_red(Sym vec_in_sym, int64_t lo, int64_t hi,
+                                    bool count = false)
+{
+    auto t_sym = _sym("t", _i64_t);
+    auto op = _op(
+        vector<Sym>{t_sym},
+        _in(t_sym, vec_in_sym) & _lte(t_sym, _i64(hi)) & _gte(t_sym, _i64(lo)),
+        vector<Expr>{vec_in_sym[{t_sym}][2]});
+    return _red(
+        op, []() { return _i64(0); },
+        [count](Expr s, Expr v) {
+            return _add(s, count ? Expr(_i64(1)) : _get(v, 1));
+        });
+}
+
+static shared_ptr<Func> range_sum_op(shared_ptr<ArrowTable2> tbl, string name,
+                                     int64_t lo, int64_t hi)
+{
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto sum = range_red(vec_in_sym, lo, hi);
+    auto sum_sym = _sym("sum", sum);
+
+    auto foo_fn = _func(name, sum_sym, vector<Sym>{vec_in_sym});
+    foo_fn->tbl[sum_sym] = sum;
+
+    return foo_fn;
+}
+
+void aggregate_op_batch_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto suffix = string(vectorize ? "_vec" : "");
+    vector<pair<int64_t, int64_t>> ranges = {
+        {10, 48}, {48, 10}, {20, 30}, {0, 100}};
+
+    vector<shared_ptr<Func>> ops;
+    vector<long> expected;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        auto [lo, hi] = ranges[i];
+        auto name = "foo_batch_" + to_string(i) + suffix;
+        auto query_fn = compile_op<void (*)(long*, void*)>(
+            range_sum_op(tbl, name, lo, hi), vectorize);
+        long output = -1;
+        query_fn(&output, tbl.get());
+        expected.push_back(output);
+
+        ops.push_back(range_sum_op(tbl, name, lo, hi));
+    }
+    ASSERT_EQ(expected[0], 696);
+    ASSERT_EQ(expected[1], 0);
+
+    long outputs[4] = {-1, -1, -1, -1};
+    auto batch_fn = compile_batch<void (*)(long*, void*)>(
+        ops, "foo_batch" + suffix, vectorize);
+    batch_fn(outputs, tbl.get());
+
+    for (size_t i = 0; i < ranges.size(); i++) {
+        ASSERT_EQ(outputs[i], expected[i]);
+    }
+}
+
+// Sum of w * column 2 over the rows with lo <= t <= hi, as parameters
+static shared_ptr<Func> param_sum_op(shared_ptr<ArrowTable2> tbl, string name)
+{
+    auto t_sym = _sym("t", _i64_t);
+    auto lo_sym = _sym("lo", _i64_t);
+    auto hi_sym = _sym("hi", _i64_t);
+    auto w_sym = _sym("w", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto op = _op(
+        vector<Sym>{t_sym},
+        _in(t_sym, vec_in_sym) & _lte(t_sym, hi_sym) & _gte(t_sym, lo_sym),
+        vector<Expr>{vec_in_sym[{t_sym}][2]});
+    auto sum = _red(
+        op, []() { return _i64(0); },
+        [w_sym](Expr s, Expr v) { return _add(s, _mul(_get(v, 0), w_sym)); });
+    auto sum_sym = _sym("sum", sum);
+
+    auto foo_fn = _func(name, sum_sym,
+                        vector<Sym>{vec_in_sym, lo_sym, hi_sym, w_sym});
+    foo_fn->tbl[sum_sym] = sum;
+
+    return foo_fn;
+}
+
+void aggregate_op_batch_param_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto suffix = string(vectorize ? "_vec" : "");
+    auto full_fn = compile_op<void (*)(long*, void*)>(
+        range_sum_op(tbl, "foo_batch_full" + suffix, 0, 100), vectorize);
+    long full = -1;
+    full_fn(&full, tbl.get());
+
+    // Each query keeps its own bounds and weight
+    vector<shared_ptr<Func>> ops = {
+        param_sum_op(tbl, "foo_batch_param_0" + suffix),
+        param_sum_op(tbl, "foo_batch_param_1" + suffix),
+    };
+    using BatchFnTy =
+        void (*)(long*, void*, long, long, long, long, long, long);
+    auto batch_fn =
+        compile_batch<BatchFnTy>(ops, "foo_batch_param" + suffix, vectorize);
+
+    long outputs[2] = {-1, -1};
+    batch_fn(outputs, tbl.get(), 10, 48, 1, 0, 100, 3);
+    ASSERT_EQ(outputs[0], 696);
+    ASSERT_EQ(outputs[1], 3 * full);
+}
+
+void aggregate_op_fusion_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto suffix = string(vectorize ? "_vec" : "");
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    vector<shared_ptr<Reduce>> reds = {
+        range_red(vec_in_sym, 10, 48),
+        range_red(vec_in_sym, 10, 48, true),
+        range_red(vec_in_sym, 20, 30),
+    };
+
+    auto foo_fn =
+        _func("foo_fusion" + suffix, nullptr, vector<Sym>{vec_in_sym});
+    vector<Expr> results;
+    vector<long> expected;
+    for (size_t i = 0; i < reds.size(); i++) {
+        auto red_sym = _sym("red", reds[i]);
+        foo_fn->tbl[red_sym] = reds[i];
+        results.push_back(red_sym);
+
+        // A single reduction is compiled as it is
+        auto name = "foo_fusion_" + to_string(i) + suffix;
+        auto single_fn = _func(name, red_sym, vector<Sym>{vec_in_sym});
+        single_fn->tbl[red_sym] = reds[i];
+        auto single_query_fn =
+            compile_op<void (*)(long*, void*)>(single_fn, vectorize);
+        long output = -1;
+        single_query_fn(&output, tbl.get());
+        expected.push_back(output);
+    }
+    foo_fn->output = _new(results);
+    ASSERT_EQ(expected[0], 696);
+
+    auto fused_fn = FusePass::Build(foo_fn);
+    size_t n_reds = 0;
+    for (auto& [sym, def] : fused_fn->tbl) {
+        if (dynamic_pointer_cast<Reduce>(def)) { n_reds++; }
+    }
+    ASSERT_EQ(n_reds, 1);
+
+    long outputs[3] = {-1, -1, -1};
+    auto query_fn = compile_op<void (*)(long*, void*)>(foo_fn, vectorize);
+    query_fn(outputs, tbl.get());
+
+    for (size_t i = 0; i < reds.size(); i++) {
+        ASSERT_EQ(outputs[i], expected[i]);
+    }
+}
+
+void aggregate_op_fusion_hazard_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto suffix = string(vectorize ? "_vec" : "");
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto* iters = (int64_t*)get_vector_data_buf(tbl.get(), 0);
+    auto t0 = iters[0];
+
+    // Sums column 2 where t == t0
+    auto t_sym = _sym("t", _i64_t);
+    auto eq_op = _op(vector<Sym>{t_sym},
+                     _in(t_sym, vec_in_sym) & _eq(t_sym, _i64(t0)),
+                     vector<Expr>{vec_in_sym[{t_sym}][2]});
+    auto eq_red = _red(
+        eq_op, []() { return _i64(0); },
+        [](Expr s, Expr v) { return _add(s, _get(v, 1)); });
+
+    // Sums 100 / (t - t0) where t != t0, which traps on the row of t0
+    auto u_sym = _sym("u", _i64_t);
+    auto div_op = _op(vector<Sym>{u_sym},
+                      _in(u_sym, vec_in_sym) & _not(_eq(u_sym, _i64(t0))),
+                      vector<Expr>{_div(_i64(100), _sub(u_sym, _i64(t0)))});
+    auto div_red = _red(
+        div_op, []() { return _i64(0); },
+        [](Expr s, Expr v) { return _add(s, _get(v, 1)); });
+
+    vector<shared_ptr<Reduce>> reds = {eq_red, div_red,
+                                       range_red(vec_in_sym, 10, 48)};
+    auto foo_fn =
+        _func("foo_fusion_hazard" + suffix, nullptr, vector<Sym>{vec_in_sym});
+    vector<Expr> results;
+    for (auto& red : reds) {
+        auto red_sym = _sym("red", red);
+        foo_fn->tbl[red_sym] = red;
+        results.push_back(red_sym);
+    }
+    foo_fn->output = _new(results);
+
+    // Only the reductions that are safe on each other's rows are fused
+    auto fused_fn = FusePass::Build(foo_fn);
+    size_t n_reds = 0;
+    for (auto& [sym, def] : fused_fn->tbl) {
+        if (dynamic_pointer_cast<Reduce>(def)) { n_reds++; }
+    }
+    ASSERT_EQ(n_reds, 2);
+
+    long outputs[3] = {-1, -1, -1};
+    auto query_fn = compile_op<void (*)(long*, void*)>(foo_fn, vectorize);
+    query_fn(outputs, tbl.get());
+
+    auto* vals = (int64_t*)get_vector_data_buf(tbl.get(), 2);
+    long eq_sum = 0, div_sum = 0;
+    for (int64_t i = 0; i < get_vector_len(tbl.get()); i++) {
+        if (iters[i] == t0) {
+            eq_sum += vals[i];
+        } else {
+            div_sum += 100 / (iters[i] - t0);
+        }
+    }
+    ASSERT_EQ(outputs[0], eq_sum);
+    ASSERT_EQ(outputs[1], div_sum);
+    ASSERT_EQ(outputs[2], 696);
+}
+
+void aggregate_op_pipeline_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto suffix = string(vectorize ? "_vec" : "");
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+
+    // sel is only scanned in order by dbl, and dbl is only reduced
+    auto t_sym = _sym("t", _i64_t);
+    auto sel = _op(
+        vector<Sym>{t_sym},
+        _in(t_sym, vec_in_sym) & _lte(t_sym, _i64(48)) & _gte(t_sym, _i64(10)),
+        vector<Expr>{vec_in_sym[{t_sym}][2]});
+    auto sel_sym = _sym("sel", sel);
+    auto u_sym = _sym("u", _i64_t);
+    auto dbl = _op(vector<Sym>{u_sym}, _in(u_sym, sel_sym),
+                   vector<Expr>{_mul(sel_sym[{u_sym}][0], _i64(2))});
+    auto dbl_sym = _sym("dbl", dbl);
+    auto sum = _red(
+        dbl_sym, []() { return _i64(0); },
+        [](Expr s, Expr v) { return _add(s, _get(v, 1)); });
+    auto sum_sym = _sym("sum", sum);
+
+    auto foo_fn = _func("foo_pipeline" + suffix, sum_sym,
+                        vector<Sym>{vec_in_sym});
+    foo_fn->tbl[sel_sym] = sel;
+    foo_fn->tbl[dbl_sym] = dbl;
+    foo_fn->tbl[sum_sym] = sum;
+
+    // Neither Op is materialized
+    auto pipelined_fn = PipelinePass::Build(foo_fn);
+    ASSERT_FALSE(pipelined_fn->tbl.contains(sel_sym));
+    ASSERT_FALSE(pipelined_fn->tbl.contains(dbl_sym));
+
+    long output = 0;
+    auto query_fn = compile_op<void (*)(long*, void*)>(foo_fn, vectorize);
+    query_fn(&output, tbl.get());
+
+    ASSERT_EQ(output, 1392);
+}
+
+static long run_red(shared_ptr<ArrowTable2> tbl, Sym vec_in_sym,
+                    shared_ptr<Reduce> red, string name, bool vectorize)
+{
+    auto red_sym = _sym("red", red);
+    auto res = _cast(_i64_t, red_sym);
+    auto res_sym = _sym("res", res);
+
+    auto foo_fn = _func(name, res_sym, vector<Sym>{vec_in_sym});
+    foo_fn->tbl[red_sym] = red;
+    foo_fn->tbl[res_sym] = res;
+
+    long output = -1;
+    auto query_fn = compile_op<void (*)(long*, void*)>(foo_fn, vectorize);
+    query_fn(&output, tbl.get());
+    return output;
+}
+
+void aggregate_op_early_exit_test(bool vectorize)
+{
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto suffix = string(vectorize ? "_vec" : "");
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto op = _op(
+        vector<Sym>{t_sym},
+        _in(t_sym, vec_in_sym) & _lte(t_sym, _i64(48)) & _gte(t_sym, _i64(10)),
+        vector<Expr>{vec_in_sym[{t_sym}][2]});
+
+    // Saturating accumulators, each paired with an equivalent one that is
+    // not recognized and scans every row
+    auto any = _red(
+        op, []() { return _false(); },
+        [](Expr s, Expr v) { return _or(_gt(_get(v, 1), _i64(20)), s); });
+    auto any_ref = _red(
+        op, []() { return _false(); },
+        [](Expr s, Expr v) {
+            return _sel(_gt(_get(v, 1), _i64(20)), _true(), s);
+        });
+    auto all = _red(
+        op, []() { return _true(); },
+        [](Expr s, Expr v) { return _and(_gt(_get(v, 1), _i64(20)), s); });
+    auto all_ref = _red(
+        op, []() { return _true(); },
+        [](Expr s, Expr v) {
+            return _sel(_gt(_get(v, 1), _i64(20)), s, _false());
+        });
+    auto first = _red(
+        op, []() { return _i64(INT64_MAX); },
+        [](Expr s, Expr v) { return _min(s, _get(v, 0)); });
+    auto first_ref = _red(
+        op, []() { return _i64(INT64_MAX); },
+        [](Expr s, Expr v) {
+            return _sel(_lt(_get(v, 0), s), _get(v, 0), s);
+        });
+
+    ASSERT_TRUE(any->done && all->done && first->done);
+    ASSERT_FALSE(any_ref->done || all_ref->done || first_ref->done);
+
+    // Only the rows of an Op are known to be visited in iterator order
+    auto first_vec = _red(
+        vec_in_sym, []() { return _i64(INT64_MAX); },
+        [](Expr s, Expr v) { return _min(s, _get(v, 0)); });
+    ASSERT_FALSE(first_vec->done);
+
+    vector<pair<shared_ptr<Reduce>, shared_ptr<Reduce>>> pairs = {
+        {any, any_ref}, {all, all_ref}, {first, first_ref}};
+    for (size_t i = 0; i < pairs.size(); i++) {
+        auto name = "foo_early_exit_" + to_string(i) + suffix;
+        auto output =
+            run_red(tbl, vec_in_sym, pairs[i].first, name, vectorize);
+        auto expected = run_red(tbl, vec_in_sym, pairs[i].second,
+                                name + "_ref", vectorize);
+        ASSERT_EQ(output, expected);
+    }
+}
+
+// Sum of column 2 over all rows
+static shared_ptr<Func> sum_all_op(shared_ptr<ArrowTable2> tbl, string name)
+{
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto op = _op(vector<Sym>{t_sym}, _in(t_sym, vec_in_sym),
+                  vector<Expr>{vec_in_sym[{t_sym}][2]});
+    auto sum = _red(
+        op, []() { return _i64(0); },
+        [](Expr s, Expr v) { return _add(s, _get(v, 1)); });
+    auto sum_sym = _sym("sum", sum);
+
+    auto foo_fn = _func(name, sum_sym, vector<Sym>{vec_in_sym});
+    foo_fn->tbl[sum_sym] = sum;
+
+    return foo_fn;
+}
+
+void aggregate_op_array_stream_test(bool vectorize)
+{
+    auto filename = string("students_array_stream.arrow");
+    auto status = split_arrow_file(STUDENTS_ARROW_FILE, filename, 3);
+    ASSERT_TRUE(status.ok()) << status.ToString();
+
+    auto tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto suffix = string(vectorize ? "_vec" : "");
+    auto query_fn = compile_op<void (*)(long*, void*)>(
+        sum_all_op(tbl, "foo_array_stream_ref" + suffix), vectorize);
+    long expected = -1;
+    query_fn(&expected, tbl.get());
+
+    auto reader = get_batch_reader(filename).ValueOrDie();
+    ArrowArrayStream stream;
+    ASSERT_TRUE(arrow::ExportRecordBatchReader(reader, &stream).ok());
+
+    StreamQuery<long> query(sum_all_op(tbl, "foo_array_stream" + suffix),
+                            vectorize);
+    auto output = query.run(&stream);
+    stream.release(&stream);
+    ASSERT_EQ(output, expected);
+
+    // Batches after the reduction is done are left in the stream
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto op = _op(vector<Sym>{t_sym}, _in(t_sym, vec_in_sym),
+                  vector<Expr>{vec_in_sym[{t_sym}][2]});
+    auto red = _red(
+        op, []() { return _i64(-1); },
+        [](Expr s, Expr v) { return _add(s, _get(v, 1)); },
+        [](Expr s) { return _gt(s, _i64(0)); });
+    auto red_sym = _sym("sum", red);
+    auto done_fn = _func("foo_array_stream_done" + suffix, red_sym,
+                         vector<Sym>{vec_in_sym});
+    done_fn->tbl[red_sym] = red;
+
+    reader = get_batch_reader(filename).ValueOrDie();
+    ASSERT_TRUE(arrow::ExportRecordBatchReader(reader, &stream).ok());
+    StreamQuery<long> done_query(done_fn, vectorize);
+    ASSERT_GT(done_query.run(&stream), 0);
+    ArrowArray rest;
+    ASSERT_EQ(stream.get_next(&stream, &rest), 0);
+    ASSERT_NE(rest.release, nullptr);
+    rest.release(&rest);
+    stream.release(&stream);
+
+    // A stream without batches yields the initial state
+    auto empty_reader =
+        arrow::RecordBatchReader::Make({}, reader->schema()).ValueOrDie();
+    ASSERT_TRUE(arrow::ExportRecordBatchReader(empty_reader, &stream).ok());
+    ASSERT_EQ(done_query.run(&stream), -1);
+    stream.release(&stream);
+}
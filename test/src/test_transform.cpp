@@ -1,4 +1,5 @@
 #include "reffine/builder/reffiner.h"
+#include "reffine/engine/memory.h"
 #include "reffine/vinstr/vinstr.h"
 #include "test_base.h"
 #include "test_utils.h"
@@ -51,3 +52,298 @@ void transform_op_test(bool vectorize)
         ASSERT_EQ((in_col1[i] + n), out_col1[i - lb]);
     }
 }
+
+void transform_op_spill_test(bool vectorize)
+{
+    auto lb = 5;
+    auto n = 10;
+
+    auto in_tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto op = transform_op(in_tbl, lb, n);
+    auto query_fn =
+        compile_op<void (*)(ArrowTable**, ArrowTable*)>(op, vectorize);
+
+    // With no budget left, the output vector is spilled
+    auto spilled = bufpool.spilled_bytes();
+    memman.set_budget(0);
+    ArrowTable* out_tbl;
+    query_fn(&out_tbl, in_tbl.get());
+    memman.set_budget(SIZE_MAX);
+    ASSERT_GT(bufpool.spilled_bytes(), spilled);
+
+    // Only the rows written count toward the budget, not the capacity the
+    // output vector is made with
+    spilled = bufpool.spilled_bytes();
+    memman.set_budget(bufpool.heap_bytes() + (1 << 20));
+    ArrowTable* heap_tbl;
+    query_fn(&heap_tbl, in_tbl.get());
+    memman.set_budget(SIZE_MAX);
+    ASSERT_EQ(bufpool.spilled_bytes(), spilled);
+    ASSERT_EQ(get_vector_len(out_tbl), get_vector_len(heap_tbl));
+
+    ASSERT_EQ(get_vector_len(in_tbl.get()) - lb, get_vector_len(out_tbl));
+
+    auto* in_col0 = (int64_t*)get_vector_data_buf(in_tbl.get(), 0);
+    auto* in_col1 = (int64_t*)get_vector_data_buf(in_tbl.get(), 1);
+    auto* out_col0 = (int64_t*)get_vector_data_buf(out_tbl, 0);
+    auto* out_col1 = (int64_t*)get_vector_data_buf(out_tbl, 1);
+    for (size_t i = 5; i < get_vector_len(in_tbl.get()); i++) {
+        ASSERT_EQ(in_col0[i], out_col0[i - lb]);
+        ASSERT_EQ((in_col1[i] + n), out_col1[i - lb]);
+    }
+
+    // A single output larger than the budget is moved to disk while it is
+    // written, so that the heap stays within the budget
+    auto t_sym = _sym("t", _i64_t);
+    auto ub_sym = _sym("ub", _i64_t);
+    auto gen_op = _op(vector<Sym>{t_sym},
+                      _gte(t_sym, _i64(0)) & _lt(t_sym, ub_sym),
+                      vector<Expr>{_add(t_sym, _i64(n))});
+    auto gen_sym = _sym("gen", gen_op);
+    auto gen_fn = _func("foo_spill_gen" + string(vectorize ? "_vec" : ""),
+                        gen_sym, vector<Sym>{ub_sym});
+    gen_fn->tbl[gen_sym] = gen_op;
+    auto gen_query_fn =
+        compile_op<void (*)(ArrowTable**, int64_t)>(gen_fn, vectorize);
+
+    int64_t n_rows = 1 << 18;  // 4 MB in two columns
+    spilled = bufpool.spilled_bytes();
+    auto budget = bufpool.heap_bytes() + (1 << 20);
+    memman.set_budget(budget);
+    ArrowTable* gen_tbl;
+    gen_query_fn(&gen_tbl, n_rows);
+    auto heap = bufpool.heap_bytes();
+    memman.set_budget(SIZE_MAX);
+    ASSERT_LE(heap, budget);
+    ASSERT_GT(bufpool.spilled_bytes(), spilled);
+
+    ASSERT_EQ(get_vector_len(gen_tbl), n_rows);
+    auto* gen_col0 = (int64_t*)get_vector_data_buf(gen_tbl, 0);
+    auto* gen_col1 = (int64_t*)get_vector_data_buf(gen_tbl, 1);
+    for (int64_t i = 0; i < n_rows; i++) {
+        ASSERT_EQ(gen_col0[i], i);
+        ASSERT_EQ(gen_col1[i], i + n);
+    }
+}
+
+void transform_op_sink_test(bool vectorize)
+{
+    auto in_tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto op = transform_op(in_tbl, 5, 10);
+    auto query_fn =
+        compile_op<void (*)(ArrowTable**, ArrowTable*)>(op, vectorize);
+
+    ArrowTable* out_tbl;
+    query_fn(&out_tbl, in_tbl.get());
+    auto len = get_vector_len(out_tbl);
+
+    // Chunks of 16 rows split the output across batches and row groups
+    for (string filename : {"transform.arrow", "transform.parquet"}) {
+        VectorSink sink(filename, "", 16);
+        sink.write(out_tbl);
+        sink.close();
+
+        auto tbl = filename.ends_with(".parquet")
+                       ? load_parquet_file(filename, 1)
+                       : load_arrow_file(filename, 1);
+        ASSERT_EQ(get_vector_len(tbl.get()), len);
+        for (uint32_t col = 0; col < 2; col++) {
+            auto* out_col = (int64_t*)get_vector_data_buf(out_tbl, col);
+            auto* col_buf = (int64_t*)get_vector_data_buf(tbl.get(), col);
+            for (int64_t i = 0; i < len; i++) {
+                ASSERT_EQ(out_col[i], col_buf[i]);
+            }
+        }
+    }
+}
+
+// Adds n to column 1 of every row and carries column 2 along
+static shared_ptr<Func> pass_through_op(shared_ptr<ArrowTable2> tbl, long n,
+                                        string name)
+{
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", tbl->get_data_type());
+    auto elem = vec_in_sym[{t_sym}];
+    auto elem_sym = _sym("elem", elem);
+    auto out = _add(elem_sym[0], _i64(n));
+    auto out_sym = _sym("out", out);
+    auto carried = elem_sym[1];
+    auto carried_sym = _sym("carried", carried);
+    auto op = _op(vector<Sym>{t_sym}, _in(t_sym, vec_in_sym),
+                  vector<Expr>{out_sym, carried_sym});
+    auto op_sym = _sym("op", op);
+
+    auto foo_fn = _func(name, op_sym, vector<Sym>{vec_in_sym});
+    foo_fn->tbl[elem_sym] = elem;
+    foo_fn->tbl[out_sym] = out;
+    foo_fn->tbl[carried_sym] = carried;
+    foo_fn->tbl[op_sym] = op;
+
+    return foo_fn;
+}
+
+void transform_op_pass_through_test(bool vectorize)
+{
+    auto n = 10;
+
+    auto in_tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto name = "foo_pass_through" + string(vectorize ? "_vec" : "");
+    auto query_fn = compile_op<void (*)(ArrowTable**, ArrowTable*)>(
+        pass_through_op(in_tbl, n, name), vectorize);
+
+    ArrowTable* out_tbl;
+    query_fn(&out_tbl, in_tbl.get());
+    auto len = get_vector_len(in_tbl.get());
+    ASSERT_EQ(get_vector_len(out_tbl), len);
+
+    // The iterator and the carried column are the input buffers
+    auto* in_col0 = (int64_t*)get_vector_data_buf(in_tbl.get(), 0);
+    auto* in_col1 = (int64_t*)get_vector_data_buf(in_tbl.get(), 1);
+    auto* in_col2 = (int64_t*)get_vector_data_buf(in_tbl.get(), 2);
+    ASSERT_EQ(get_vector_data_buf(out_tbl, 0), in_col0);
+    ASSERT_EQ(get_vector_data_buf(out_tbl, 2), in_col2);
+
+    auto* out_col1 = (int64_t*)get_vector_data_buf(out_tbl, 1);
+    for (int64_t i = 0; i < len; i++) {
+        ASSERT_EQ(in_col1[i] + n, out_col1[i]);
+    }
+
+    // Same through LLVMGen, whose alias scopes must allow for the shared
+    // columns
+    auto llvm_fn = compile_loop<void (*)(ArrowTable**, ArrowTable*)>(
+        gen_loop(pass_through_op(in_tbl, n, name + "_llvm"), vectorize),
+        false);
+    ArrowTable* llvm_tbl;
+    llvm_fn(&llvm_tbl, in_tbl.get());
+    ASSERT_EQ(get_vector_len(llvm_tbl), len);
+    ASSERT_EQ(get_vector_data_buf(llvm_tbl, 0), in_col0);
+    ASSERT_EQ(get_vector_data_buf(llvm_tbl, 2), in_col2);
+    auto* llvm_col1 = (int64_t*)get_vector_data_buf(llvm_tbl, 1);
+    for (int64_t i = 0; i < len; i++) {
+        ASSERT_EQ(in_col1[i] + n, llvm_col1[i]);
+    }
+}
+
+// Outputs column 2 of every row of a vector whose iterator column is run-end
+// encoded, so that no column is passed through
+void transform_op_runend_test(bool vectorize)
+{
+    auto in_tbl = get_input_vector(RUNEND_ARROW_FILE, 1).ValueOrDie();
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", in_tbl->get_data_type());
+    auto carried = vec_in_sym[{t_sym}][1];
+    auto carried_sym = _sym("carried", carried);
+    auto op = _op(vector<Sym>{t_sym}, _in(t_sym, vec_in_sym),
+                  vector<Expr>{carried_sym});
+    auto op_sym = _sym("op", op);
+
+    auto name = "foo_runend" + string(vectorize ? "_vec" : "");
+    auto foo_fn = _func(name, op_sym, vector<Sym>{vec_in_sym});
+    foo_fn->tbl[carried_sym] = carried;
+    foo_fn->tbl[op_sym] = op;
+
+    auto query_fn =
+        compile_op<void (*)(ArrowTable**, ArrowTable*)>(foo_fn, vectorize);
+    ArrowTable* out_tbl;
+    query_fn(&out_tbl, in_tbl.get());
+
+    // A row per run of the iterator column
+    ASSERT_EQ(get_vector_len(out_tbl), 4);
+    auto* out_col0 = (int64_t*)get_vector_data_buf(out_tbl, 0);
+    auto* out_col1 = (int64_t*)get_vector_data_buf(out_tbl, 1);
+    for (int64_t i = 0; i < 4; i++) {
+        ASSERT_EQ(out_col0[i], i + 1);
+        ASSERT_EQ(out_col1[i], i);
+    }
+}
+
+void transform_op_null_iter_test(bool vectorize)
+{
+    arrow::Int64Builder ids;
+    arrow::Int64Builder vals;
+    for (int64_t i = 0; i < 6; i++) {
+        auto status = (i % 3 == 1) ? ids.AppendNull() : ids.Append(i);
+        ASSERT_TRUE(status.ok());
+        ASSERT_TRUE(vals.Append(10 + i).ok());
+    }
+    auto schema = arrow::schema({arrow::field("id", arrow::int64()),
+                                 arrow::field("val", arrow::int64())});
+    auto rbatch = arrow::RecordBatch::Make(
+        schema, 6, {ids.Finish().ValueOrDie(), vals.Finish().ValueOrDie()});
+    auto in_tbl = get_batch_vector(rbatch, 1).ValueOrDie();
+
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", in_tbl->get_data_type());
+    auto carried = vec_in_sym[{t_sym}][0];
+    auto carried_sym = _sym("carried", carried);
+    auto op = _op(vector<Sym>{t_sym}, _in(t_sym, vec_in_sym),
+                  vector<Expr>{carried_sym});
+    auto op_sym = _sym("op", op);
+
+    auto name = "foo_null_iter" + string(vectorize ? "_vec" : "");
+    auto foo_fn = _func(name, op_sym, vector<Sym>{vec_in_sym});
+    foo_fn->tbl[carried_sym] = carried;
+    foo_fn->tbl[op_sym] = op;
+
+    auto query_fn =
+        compile_op<void (*)(ArrowTable**, ArrowTable*)>(foo_fn, vectorize);
+    ArrowTable* out_tbl;
+    query_fn(&out_tbl, in_tbl.get());
+
+    auto* in_col1 = get_vector_data_buf(in_tbl.get(), 1);
+    auto* out_col0 = (int64_t*)get_vector_data_buf(out_tbl, 0);
+    auto* out_col1 = (int64_t*)get_vector_data_buf(out_tbl, 1);
+    if (vectorize) {
+        // Rows with a null iterator are null outputs, so rows stay aligned
+        ASSERT_EQ(get_vector_len(out_tbl), 6);
+        ASSERT_EQ(get_vector_data_buf(out_tbl, 1), in_col1);
+        return;
+    }
+
+    // Rows with a null iterator are skipped, and the rest are copied
+    vector<int64_t> valid = {0, 2, 3, 5};
+    ASSERT_EQ(get_vector_len(out_tbl), (int64_t)valid.size());
+    ASSERT_NE(get_vector_data_buf(out_tbl, 1), in_col1);
+    for (size_t i = 0; i < valid.size(); i++) {
+        ASSERT_EQ(out_col0[i], valid[i]);
+        ASSERT_EQ(out_col1[i], 10 + valid[i]);
+    }
+}
+
+void transform_op_projection_test(bool vectorize)
+{
+    auto full_tbl = get_input_vector(STUDENTS_ARROW_FILE, 1).ValueOrDie();
+    auto t_sym = _sym("t", _i64_t);
+    auto vec_in_sym = _sym("vec_in", full_tbl->get_data_type());
+    auto carried = vec_in_sym[{t_sym}][1];
+    auto carried_sym = _sym("carried", carried);
+    auto op = _op(vector<Sym>{t_sym}, _in(t_sym, vec_in_sym),
+                  vector<Expr>{carried_sym});
+    auto op_sym = _sym("op", op);
+
+    auto name = "foo_carried" + string(vectorize ? "_vec" : "");
+    auto foo_fn = _func(name, op_sym, vector<Sym>{vec_in_sym});
+    foo_fn->tbl[carried_sym] = carried;
+    foo_fn->tbl[op_sym] = op;
+    auto loop = gen_loop(foo_fn, vectorize);
+
+    // The carried column is only ever passed through, never read
+    auto cols = ProjectPass::Columns(loop);
+    ASSERT_EQ(cols.size(), 1u);
+    auto& vec_cols = cols.begin()->second;
+    ASSERT_TRUE(vec_cols.contains(0) && vec_cols.contains(2));
+    ASSERT_FALSE(vec_cols.contains(1));
+
+    auto in_tbl = load_arrow_file(STUDENTS_ARROW_FILE, 1, vec_cols);
+    in_tbl->build_index();
+
+    auto query_fn = compile_loop<void (*)(ArrowTable**, ArrowTable*)>(
+        ProjectPass::Build(loop, cols));
+    ArrowTable* out_tbl;
+    query_fn(&out_tbl, in_tbl.get());
+
+    auto len = get_vector_len(in_tbl.get());
+    ASSERT_EQ(get_vector_len(out_tbl), len);
+    ASSERT_EQ(get_vector_data_buf(out_tbl, 1),
+              get_vector_data_buf(in_tbl.get(), 1));
+}
@@ -15,6 +15,12 @@ arrow::Result<std::shared_ptr<ArrowTable2>> get_input_vector(
                           arrow::ipc::RecordBatchFileReader::Open(infile));
     ARROW_ASSIGN_OR_RAISE(auto rbatch, ipc_reader->ReadRecordBatch(0));
 
+    return get_batch_vector(rbatch, dim);
+}
+
+arrow::Result<std::shared_ptr<ArrowTable2>> get_batch_vector(
+    std::shared_ptr<arrow::RecordBatch> rbatch, int64_t dim)
+{
     auto table = std::make_shared<ArrowTable2>(dim);
     ARROW_RETURN_NOT_OK(
         arrow::ExportRecordBatch(*rbatch, table->array, table->schema));
@@ -23,6 +29,76 @@ arrow::Result<std::shared_ptr<ArrowTable2>> get_input_vector(
     return table;
 }
 
+arrow::Status split_arrow_file(std::string in, std::string out,
+                              int64_t n_batches)
+{
+    ARROW_ASSIGN_OR_RAISE(
+        auto infile,
+        arrow::io::ReadableFile::Open(in, arrow::default_memory_pool()));
+    ARROW_ASSIGN_OR_RAISE(auto ipc_reader,
+                          arrow::ipc::RecordBatchFileReader::Open(infile));
+    ARROW_ASSIGN_OR_RAISE(auto rbatch, ipc_reader->ReadRecordBatch(0));
+
+    ARROW_ASSIGN_OR_RAISE(auto outfile, arrow::io::FileOutputStream::Open(out));
+    ARROW_ASSIGN_OR_RAISE(auto writer, arrow::ipc::MakeFileWriter(
+                                           outfile, rbatch->schema()));
+    auto len = rbatch->num_rows();
+    auto batch_len = (len + n_batches - 1) / n_batches;
+    for (int64_t start = 0; start < len; start += batch_len) {
+        ARROW_RETURN_NOT_OK(
+            writer->WriteRecordBatch(*rbatch->Slice(start, batch_len)));
+    }
+    return writer->Close();
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatchReader>> get_batch_reader(
+    std::string filename)
+{
+    ARROW_ASSIGN_OR_RAISE(
+        auto infile,
+        arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool()));
+    ARROW_ASSIGN_OR_RAISE(auto ipc_reader,
+                          arrow::ipc::RecordBatchFileReader::Open(infile));
+
+    arrow::RecordBatchVector batches;
+    for (int i = 0; i < ipc_reader->num_record_batches(); i++) {
+        ARROW_ASSIGN_OR_RAISE(auto rbatch, ipc_reader->ReadRecordBatch(i));
+        batches.push_back(rbatch);
+    }
+    return arrow::RecordBatchReader::Make(batches, ipc_reader->schema());
+}
+
+arrow::Status write_parquet_file(std::string in, std::string out,
+                                int64_t row_group_len)
+{
+    ARROW_ASSIGN_OR_RAISE(
+        auto infile,
+        arrow::io::ReadableFile::Open(in, arrow::default_memory_pool()));
+    ARROW_ASSIGN_OR_RAISE(auto ipc_reader,
+                          arrow::ipc::RecordBatchFileReader::Open(infile));
+    ARROW_ASSIGN_OR_RAISE(auto rbatch, ipc_reader->ReadRecordBatch(0));
+    ARROW_ASSIGN_OR_RAISE(auto table,
+                          arrow::Table::FromRecordBatches({rbatch}));
+
+    ARROW_ASSIGN_OR_RAISE(auto outfile, arrow::io::FileOutputStream::Open(out));
+    return parquet::arrow::WriteTable(*table, arrow::default_memory_pool(),
+                                      outfile, row_group_len);
+}
+
+arrow::Status write_csv_file(std::string in, std::string out)
+{
+    ARROW_ASSIGN_OR_RAISE(
+        auto infile,
+        arrow::io::ReadableFile::Open(in, arrow::default_memory_pool()));
+    ARROW_ASSIGN_OR_RAISE(auto ipc_reader,
+                          arrow::ipc::RecordBatchFileReader::Open(infile));
+    ARROW_ASSIGN_OR_RAISE(auto rbatch, ipc_reader->ReadRecordBatch(0));
+
+    ARROW_ASSIGN_OR_RAISE(auto outfile, arrow::io::FileOutputStream::Open(out));
+    return arrow::csv::WriteCSV(*rbatch, arrow::csv::WriteOptions::Defaults(),
+                                outfile.get());
+}
+
 std::string print_arrow_table(ArrowTable* tbl)
 {
     auto res = arrow::ImportRecordBatch(tbl->array, tbl->schema).ValueOrDie();
@@ -26,3 +26,18 @@ void z3solver_test()
     run_lower_bound_check(0);
     run_lower_bound_check(-543);
 }
+
+void z3solver_same_name_test()
+{
+    // e.g. the iterators of an op nested in another
+    auto t1 = _sym("t", types::INT64);
+    auto t2 = _sym("t", types::INT64);
+
+    Z3Solver solver;
+    ASSERT_TRUE(solver.check(_eq(t1, _i64(1)) & _eq(t2, _i64(2))));
+    ASSERT_EQ(solver.get(t1)->val, 1);
+    ASSERT_EQ(solver.get(t2)->val, 2);
+
+    Z3Solver same_solver;
+    ASSERT_TRUE(same_solver.refute(_eq(t1, _i64(1)) & _eq(t1, _i64(2))));
+}